@@ -0,0 +1,41 @@
+#include "arq.h"
+#include "framing.h"
+
+size_t arq_frame_slots(size_t chunk)
+{
+    return 8 * (FRAME_HDR_BYTES + chunk + FRAME_CRC_BYTES);
+}
+
+size_t arq_round_slots(size_t chunk)
+{
+    return arq_frame_slots(chunk) + ARQ_GUARD + ARQ_ACK_SLOTS + ARQ_GUARD;
+}
+
+size_t arq_ack_slot(size_t chunk, int k)
+{
+    return arq_frame_slots(chunk) + ARQ_GUARD + (size_t)k;
+}
+
+int arq_ack_chip(int ack, int k)
+{
+    return (k & 1) == (ack ? 0 : 1);
+}
+
+int arq_decide(const double *bw, int nslots, double *margin)
+{
+    double sum   = 0.0;
+    int    pairs = 0;
+
+    for (int k = 0; k + 1 < nslots; k += 2) {
+        if (bw[k] <= 0.0 || bw[k + 1] <= 0.0) continue;
+        /* ACK hammers the first half, which then sees less bandwidth */
+        sum += (bw[k + 1] - bw[k]) / (bw[k + 1] + bw[k]);
+        pairs++;
+    }
+    if (margin) *margin = pairs ? sum / pairs : 0.0;
+    if (!pairs) return -1;
+    sum /= pairs;
+    if (sum >  ARQ_MIN_DEPTH) return 1;
+    if (sum < -ARQ_MIN_DEPTH) return 0;
+    return -1;
+}
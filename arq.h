@@ -0,0 +1,49 @@
+#ifndef ARQ_H
+#define ARQ_H
+
+#include <stddef.h>
+
+/*
+ * Stop-and-wait ARQ over the half-duplex bandwidth channel.
+ *
+ * After the preamble, time is divided into rounds of arq_round_slots()
+ * symbol slots.  A round carries one frame (framing.h) from the
+ * transmitter, starting at the round's first slot and padded with idle
+ * slots up to the largest frame for the agreed payload size, then a guard
+ * slot, ARQ_ACK_SLOTS reverse slots and another guard.  In the reverse
+ * slots the roles swap: the receiver drives contention and the
+ * transmitter measures bandwidth.
+ *
+ * The answer is sent as ARQ_ACK_PAIRS Manchester pairs, ACK = hammered
+ * then idle, NACK = idle then hammered, so the transmitter compares the
+ * two halves of each pair and needs no threshold of its own.  Silence or
+ * a mixed answer is treated like a NACK.  The transmitter resends a frame
+ * until it is acknowledged (at most ARQ_RETRIES times); the receiver
+ * acknowledges a repeat of the frame it already wrote, in case its ACK was
+ * the part that got lost, without writing it again.
+ */
+#define ARQ_ACK_PAIRS 2
+#define ARQ_ACK_SLOTS (2 * ARQ_ACK_PAIRS)
+#define ARQ_GUARD     1       /* idle slots on each side of the reverse window */
+#define ARQ_RETRIES   8
+#define ARQ_MIN_DEPTH 0.05    /* mean (idle - hammered) / (idle + hammered) per pair */
+
+/* Forward slots per round for payloads of up to `chunk` bytes. */
+size_t arq_frame_slots(size_t chunk);
+/* Slots per round, forward + reverse. */
+size_t arq_round_slots(size_t chunk);
+/* Offset of reverse slot k (0..ARQ_ACK_SLOTS-1) from the round start. */
+size_t arq_ack_slot(size_t chunk, int k);
+
+/* Whether the receiver hammers reverse slot k when answering `ack`. */
+int    arq_ack_chip(int ack, int k);
+
+/*
+ * Decides the answer from the mean bandwidth of each reverse slot (0 for
+ * a slot without samples).  Returns 1 for ACK, 0 for NACK and -1 if the
+ * answer is unclear; *margin (may be NULL) gets the signed pair contrast,
+ * positive toward ACK.
+ */
+int    arq_decide(const double *bw, int nslots, double *margin);
+
+#endif
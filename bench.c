@@ -0,0 +1,358 @@
+/*
+ * Benchmark harness for the bandwidth channel (replaces error_percent.py).
+ *
+ * The transmitter and the receiver run as two threads of this process
+ * (loopback.h) and share the mysecond() clock, so every time below comes
+ * from the actual schedule instead of being guessed from outside.  For each point of the
+ * sweep (bit duration x code x payload size) the harness sends --repeats
+ * random payloads through the same path as the ECC binaries: Barker
+ * preamble, sync_wait(), one tracked-threshold decision per window, then
+ * the ECC decoder.  Per run it records
+ *
+ *   raw_bps       coded bits / coded airtime
+ *   channel_ber   coded bit errors before decoding
+ *   ber           data bit errors after decoding
+ *   goodput_bps   correct data bits / elapsed time
+ *   capacity_bps  raw_bps * (1 - H(channel_ber)), the binary symmetric
+ *                 channel bound for this symbol rate
+ *
+ * --channel cache runs the same sweep over the clocked Prime+Probe cache
+ * channel (cache_channel.h) instead: durations are then window lengths,
+ * tens of microseconds, and each window carries --sets bits.
+ *
+ * Elapsed time runs from the first preamble chip until the decoder has
+ * produced the data bits.  A run whose preamble is not found counts as
+ * delivering nothing (BER 0.5, goodput and capacity 0).  Each point is
+ * reported as the mean and 95% confidence half-width over its runs
+ * (stats.h), as CSV or JSON.
+ *
+ *  gcc -fopenmp -O3 -pthread bench.c loopback.c contention_pool.c stream_sampler.c robust.c \
+ *      sync.c level_tracker.c ecc.c conv.c stats.c cache_channel.c primeprobe.c evset.c \
+ *      topology.c hugemem.c kernels.c timing.c -o bench -lm
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "timing.h"
+#include "topology.h"
+#include "loopback.h"
+#include "cache_channel.h"
+#include "level_tracker.h"
+#include "ecc.h"
+#include "stats.h"
+
+#define SAMPLER_ELEMS 500000
+#define MAX_POINTS    32        /* entries per sweep list */
+#define DEFAULT_DURATIONS "0.1"
+#define DEFAULT_CACHE_DURATIONS "50e-6"
+#define DEFAULT_CODES     "none"
+#define DEFAULT_SIZES     "64"
+#define DEFAULT_REPEATS   3
+
+enum metric { RAW_BPS, CHANNEL_BER, BER, GOODPUT_BPS, CAPACITY_BPS, ELAPSED, NMETRICS };
+static const char *const metric_names[NMETRICS] = {
+    "raw_bps", "channel_ber", "ber", "goodput_bps", "capacity_bps", "elapsed_s"
+};
+
+struct point {
+    double         duration;
+    const char    *code;
+    int            bits;
+    int            runs;
+    int            sync_failures;
+    struct summary m[NMETRICS];
+};
+
+static struct loopback    lb;
+static struct cc_loopback clb;
+static int                cache;            /* --channel cache */
+static int                bits_per_chip = 1;
+static uint64_t           rng_state;
+static int                soft;
+
+static uint64_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static size_t count_errors(const struct bitvec *a, const struct bitvec *b, size_t n)
+{
+    size_t e = 0;
+    for (size_t i = 0; i < n; i++) e += bitvec_get(a, i) != bitvec_get(b, i);
+    return e;
+}
+
+/* One payload end to end; v[] gets the per-run metrics. Returns -1 on error. */
+static int run_once(const struct ecc_code *code, double chip, int bits,
+                    double v[NMETRICS], int *synced)
+{
+    struct bitvec    data = {0}, coded = {0}, rx = {0}, out = {0};
+    struct ecc_stats st;
+    float           *llr = NULL;
+    double           start, done;
+    int              rc  = -1;
+
+    if (bitvec_init(&data, bits) != 0) return -1;
+    for (int i = 0; i < bits; i++) bitvec_set(&data, i, next_random() & 1);
+
+    if (ecc_encode(code, &data, &coded) == 0 && bitvec_init(&rx, coded.nbits) == 0 &&
+        (llr = calloc(coded.nbits ? coded.nbits : 1, sizeof(float))) != NULL) {
+        int sent = cache ? cc_loopback_send(&clb, &coded, chip, &rx, llr, &start, &done)
+                         : loopback_send(&lb, &coded, chip, &rx, llr, &start, &done);
+
+        *synced = sent == 0;
+        if (sent == 0) {
+            rc = soft ? ecc_decode_soft(code, llr, rx.nbits, bits, &out, &st)
+                      : ecc_decode(code, &rx, bits, &out, &st);
+            done = mysecond();
+        } else if (sent == 1) {
+            rc = 0;
+        }
+
+        if (rc == 0 && *synced) {
+            double airtime = cc_windows(coded.nbits, bits_per_chip) * chip;
+            double elapsed = done - start;
+            double cber    = (double)count_errors(&coded, &rx, coded.nbits) / coded.nbits;
+            size_t errors  = count_errors(&data, &out, bits);
+
+            v[RAW_BPS]      = coded.nbits / airtime;
+            v[CHANNEL_BER]  = cber;
+            v[BER]          = (double)errors / bits;
+            v[GOODPUT_BPS]  = (bits - errors) / elapsed;
+            v[CAPACITY_BPS] = v[RAW_BPS] * stats_bsc_capacity(cber);
+            v[ELAPSED]      = elapsed;
+        } else if (rc == 0) {
+            v[RAW_BPS]      = bits_per_chip / chip;
+            v[CHANNEL_BER]  = 0.5;
+            v[BER]          = 0.5;
+            v[GOODPUT_BPS]  = 0.0;
+            v[CAPACITY_BPS] = 0.0;
+            v[ELAPSED]      = done - start;
+        }
+    } else if (!llr) {
+        fprintf(stderr, "bench: out of memory for %d bits\n", bits);
+    }
+
+    free(llr);
+    bitvec_free(&out);
+    bitvec_free(&rx);
+    bitvec_free(&coded);
+    bitvec_free(&data);
+    return rc;
+}
+
+static int measure_point(struct point *p, int repeats)
+{
+    struct ecc_code code;
+    double          v[NMETRICS] = {0}, runs[NMETRICS][repeats];
+    const char     *name = strcmp(p->code, "none") == 0 ? "rep1" : p->code;
+
+    if (ecc_code_select(&code, name) != 0) return -1;
+    p->runs = p->sync_failures = 0;
+    for (int r = 0; r < repeats; r++) {
+        int synced = 0;
+        if (run_once(&code, p->duration, p->bits, v, &synced) != 0) return -1;
+        if (!synced) p->sync_failures++;
+        for (int m = 0; m < NMETRICS; m++) runs[m][r] = v[m];
+        p->runs++;
+        fprintf(stderr, "bench: %.4fs %s %d bits, run %d/%d: %s, channel BER %.4f, BER %.4f, "
+                "goodput %.2f bit/s\n", p->duration, p->code, p->bits, r + 1, repeats,
+                synced ? "synced" : "no preamble", v[CHANNEL_BER], v[BER], v[GOODPUT_BPS]);
+    }
+    for (int m = 0; m < NMETRICS; m++) stats_summarize(runs[m], repeats, &p->m[m]);
+    return 0;
+}
+
+static void put_number(FILE *f, double x, const char *missing)
+{
+    if (isnan(x)) fputs(missing, f);
+    else          fprintf(f, "%.6g", x);
+}
+
+static void write_csv(FILE *f, const struct point *pts, int n)
+{
+    fprintf(f, "bit_duration,code,bits,runs,sync_failures");
+    for (int m = 0; m < NMETRICS; m++) fprintf(f, ",%s,%s_ci", metric_names[m], metric_names[m]);
+    fprintf(f, "\n");
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "%.6g,%s,%d,%d,%d", pts[i].duration, pts[i].code, pts[i].bits,
+                pts[i].runs, pts[i].sync_failures);
+        for (int m = 0; m < NMETRICS; m++) {
+            fputc(',', f);
+            put_number(f, pts[i].m[m].mean, "");
+            fputc(',', f);
+            put_number(f, pts[i].m[m].ci, "");
+        }
+        fprintf(f, "\n");
+    }
+}
+
+static void write_json(FILE *f, const struct point *pts, int n)
+{
+    fprintf(f, "[\n");
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "  {\"bit_duration\": %.6g, \"code\": \"%s\", \"bits\": %d, "
+                "\"runs\": %d, \"sync_failures\": %d", pts[i].duration, pts[i].code,
+                pts[i].bits, pts[i].runs, pts[i].sync_failures);
+        for (int m = 0; m < NMETRICS; m++) {
+            fprintf(f, ",\n   \"%s\": {\"mean\": ", metric_names[m]);
+            put_number(f, pts[i].m[m].mean, "null");
+            fprintf(f, ", \"ci\": ");
+            put_number(f, pts[i].m[m].ci, "null");
+            fprintf(f, "}");
+        }
+        fprintf(f, "}%s\n", i + 1 < n ? "," : "");
+    }
+    fprintf(f, "]\n");
+}
+
+/* Splits a comma list in place; returns the number of entries or -1. */
+static int split_list(char *s, char **item, int max)
+{
+    int n = 0;
+    for (char *tok = strtok(s, ","); tok; tok = strtok(NULL, ",")) {
+        if (n == max) {
+            fprintf(stderr, "bench: more than %d entries in a list\n", max);
+            return -1;
+        }
+        item[n++] = tok;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    timing_init();
+
+    char        durations[256] = "";
+    char        codes[256]     = DEFAULT_CODES;
+    char        sizes[256]     = DEFAULT_SIZES;
+    int         repeats  = DEFAULT_REPEATS;
+    int         nthreads = 0;
+    long        elems    = SAMPLER_ELEMS;
+    double      period   = 0.0;
+    const char *tx_cpus  = NULL;
+    const char *rx_cpus  = NULL;
+    int         node     = -1;
+    const char *kernel   = NULL;
+    double      alpha    = LEVEL_ALPHA;
+    const char *format   = "csv";
+    const char *out_path = "-";
+    uint64_t    seed     = (uint64_t)time(NULL);
+    const char *channel  = "bw";
+    size_t      thrash_mb = 0;
+    const char *evcache  = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--durations") == 0 && i+1 < argc) snprintf(durations, sizeof(durations), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--codes")     == 0 && i+1 < argc) snprintf(codes, sizeof(codes), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--sizes")     == 0 && i+1 < argc) snprintf(sizes, sizeof(sizes), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--repeats")   == 0 && i+1 < argc) repeats  = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--soft")      == 0)               soft     = 1;
+        else if (strcmp(argv[i], "--alpha")     == 0 && i+1 < argc) alpha    = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads")   == 0 && i+1 < argc) nthreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--elems")     == 0 && i+1 < argc) elems    = atol(argv[++i]);
+        else if (strcmp(argv[i], "--sample-period") == 0 && i+1 < argc) period = atof(argv[++i]);
+        else if (strcmp(argv[i], "--tx-cpus")   == 0 && i+1 < argc) tx_cpus  = argv[++i];
+        else if (strcmp(argv[i], "--rx-cpus")   == 0 && i+1 < argc) rx_cpus  = argv[++i];
+        else if (strcmp(argv[i], "--node")      == 0 && i+1 < argc) node     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--kernel")    == 0 && i+1 < argc) kernel   = argv[++i];
+        else if (strcmp(argv[i], "--format")    == 0 && i+1 < argc) format   = argv[++i];
+        else if (strcmp(argv[i], "--out")       == 0 && i+1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "--seed")      == 0 && i+1 < argc) seed     = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--channel")   == 0 && i+1 < argc) channel  = argv[++i];
+        else if (strcmp(argv[i], "--sets")      == 0 && i+1 < argc) bits_per_chip = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--thrash-mb") == 0 && i+1 < argc) thrash_mb = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--evsets")    == 0 && i+1 < argc) evcache  = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--durations s,s] [--codes none,rep3,hamming74,secded,conv]\n"
+                            "       [--sizes bits,bits] [--repeats n] [--soft] [--format csv|json] [--out FILE|-]\n"
+                            "       [--tx-cpus LIST] [--rx-cpus LIST] [--node N] [--threads n] [--kernel K]\n"
+                            "       [--elems n | --sample-period s] [--alpha a] [--seed n]\n"
+                            "       [--channel bw|cache] [--sets K] [--thrash-mb M] [--evsets FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    cache = strcmp(channel, "cache") == 0;
+    if ((!cache && strcmp(channel, "bw") != 0) || (cache && (bits_per_chip < 1 || bits_per_chip > PP_MAX_SETS))) {
+        fprintf(stderr, "bench: --channel bw|cache, and --sets 1..%d for the cache channel\n", PP_MAX_SETS);
+        return 1;
+    }
+    if (!cache) bits_per_chip = 1;
+    if (!durations[0])
+        snprintf(durations, sizeof(durations), "%s", cache ? DEFAULT_CACHE_DURATIONS : DEFAULT_DURATIONS);
+
+    char *dl[MAX_POINTS], *cl[MAX_POINTS], *sl[MAX_POINTS];
+    int   nd = split_list(durations, dl, MAX_POINTS);
+    int   nc = split_list(codes, cl, MAX_POINTS);
+    int   ns = split_list(sizes, sl, MAX_POINTS);
+    int   json = strcmp(format, "json") == 0;
+
+    if (nd < 1 || nc < 1 || ns < 1 || repeats < 1 || (!json && strcmp(format, "csv") != 0)) {
+        fprintf(stderr, "bench: need non-empty lists, --repeats >= 1 and --format csv|json\n");
+        return 1;
+    }
+    rng_state = seed ? seed : 1;
+
+    static struct placement tx, rx;
+    const struct mem_kernel *k = kernel_select(kernel);
+    if (!k || placement_init(&tx, tx_cpus, node) != 0 || placement_init(&rx, rx_cpus, node) != 0)
+        return 1;
+    if (!tx.ncpus) placement_online(&tx);
+    if (nthreads < 1) nthreads = tx.ncpus;
+    placement_print(&tx, "bench: transmitter", stderr);
+    placement_print(&rx, "bench: receiver", stderr);
+
+    if (cache) {
+        if (cc_loopback_start(&clb, bits_per_chip, thrash_mb << 20, evcache,
+                              placement_cpu(&tx, 0), placement_cpu(&rx, 0), node) != 0)
+            return 1;
+        fprintf(stderr, "bench: cache channel, %d set(s), %zu thrash lines each, seed %llu\n",
+                bits_per_chip, clb.tx.nlines, (unsigned long long)seed);
+    } else {
+        if (loopback_start(&lb, nthreads, &tx, &rx, k, (size_t)elems, period) != 0) return 1;
+        lb.alpha = alpha;
+        fprintf(stderr, "bench: %d worker(s), %s kernel, sampler %zu elements (%.3f ms per pass), seed %llu\n",
+                nthreads, k->name, lb.sampler.n, 1e3 * lb.sampler.last_pass, (unsigned long long)seed);
+    }
+
+    struct point *pts = calloc((size_t)nd * nc * ns, sizeof(*pts));
+    int           npts = 0, rc = 0;
+    if (!pts) { perror("bench: calloc"); return 1; }
+
+    for (int d = 0; d < nd && !rc; d++)
+    for (int c = 0; c < nc && !rc; c++)
+    for (int s = 0; s < ns && !rc; s++) {
+        struct point *p = &pts[npts];
+        p->duration = atof(dl[d]);
+        p->code     = cl[c];
+        p->bits     = atoi(sl[s]);
+        if (p->duration <= 0.0 || p->bits < 1) {
+            fprintf(stderr, "bench: bad point %s s / %s bits\n", dl[d], sl[s]);
+            rc = 1;
+        } else if (measure_point(p, repeats) != 0) {
+            rc = 1;
+        } else {
+            npts++;
+        }
+    }
+
+    if (cache) cc_loopback_stop(&clb);
+    else       loopback_stop(&lb);
+
+    FILE *f = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (!f) { perror(out_path); free(pts); return 1; }
+    if (json) write_json(f, pts, npts);
+    else      write_csv(f, pts, npts);
+    if (f != stdout && fclose(f) != 0) { perror(out_path); rc = 1; }
+    free(pts);
+    return rc;
+}
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "cache_channel.h"
+#include "timing.h"
+#include "topology.h"
+
+struct tx_job {
+    const struct pp_thrasher *t;
+    const struct bitvec      *bits;
+    double                    start;
+    double                    chip;
+    int                       cpu;
+};
+
+size_t cc_windows(size_t nbits, int nsets)
+{
+    return (nbits + (size_t)nsets - 1) / (size_t)nsets;
+}
+
+/* A '1' preamble chip (sync_send_preamble()): every channel set at once. */
+static void preamble_chip(void *arg, double end)
+{
+    const struct pp_thrasher *t = arg;
+
+    pp_thrash_until(t, (1u << t->nsets) - 1, end);
+}
+
+void cc_transmit(const struct pp_thrasher *t, const struct bitvec *bits, double chip, double start)
+{
+    size_t n = cc_windows(bits->nbits, t->nsets);
+
+    sync_send_preamble(start, chip, preamble_chip, NULL, (void *)t);
+    start += SYNC_CHIPS * chip;
+    for (size_t i = 0; i < n; i++) {
+        unsigned mask = 0;
+
+        for (int k = 0; k < t->nsets; k++) {
+            size_t b = i * t->nsets + k;
+            if (b < bits->nbits && bitvec_get(bits, b)) mask |= 1u << k;
+        }
+        sleep_until(start + i * chip);
+        pp_thrash_until(t, mask, start + (i + 1) * chip);
+    }
+}
+
+/* One probe round as a bandwidth-like level: 1 untouched, lower when thrashed. */
+static double probe_level(const struct pp_receiver *r)
+{
+    uint64_t cycles[PP_MAX_SETS];
+    double   v = 0.0;
+
+    pp_sample(r, cycles);
+    for (int k = 0; k < r->nsets; k++)
+        v += cycles[k] ? (double)r->set[k].quiet / cycles[k] : 1.0;
+    return v / r->nsets;
+}
+
+int cc_sync(const struct pp_receiver *r, double chip, double timeout, struct sync_result *s)
+{
+    static double t[SYNC_MAX_SAMPLES], v[SYNC_MAX_SAMPLES];
+    double deadline = mysecond() + timeout;
+    int    n = 0;
+
+    for (int k = 0; k < r->nsets; k++) pp_prime(&r->set[k]);
+    while (mysecond() < deadline) {
+        if (n > SYNC_MAX_SAMPLES * 3 / 4) {
+            int keep = SYNC_MAX_SAMPLES / 4;
+            memmove(t, t + n - keep, keep * sizeof(double));
+            memmove(v, v + n - keep, keep * sizeof(double));
+            n = keep;
+        }
+
+        /* a few chips of probes between searches */
+        double until = mysecond() + 4 * chip;
+        while (n < SYNC_MAX_SAMPLES && (t[n] = mysecond()) < until) {
+            v[n] = probe_level(r);
+            n++;
+        }
+
+        /* only the tail can hold a new match; a short search keeps probe gaps short */
+        double from  = t[n - 1] - (SYNC_LEN + 3) * chip;
+        int    first = n - 1;
+        while (first > 0 && t[first - 1] >= from - chip) first--;
+        if (sync_detect(t + first, v + first, n - first, chip, from, s) == 0)
+            return 0;
+    }
+    return -1;
+}
+
+int cc_receive(const struct pp_receiver *r, double chip, double timeout,
+               struct bitvec *rx, float *llr, double *start)
+{
+    struct sync_result s;
+    size_t             n = cc_windows(rx->nbits, r->nsets);
+
+    if (cc_sync(r, chip, timeout, &s) != 0) return -1;
+    *start = s.start;
+
+    double t0 = s.start + SYNC_CHIPS * chip;
+    for (size_t i = 0; i < n; i++) {
+        double   begin = t0 + i * chip + CC_EDGE * chip;
+        double   end   = t0 + (i + 1) * chip - CC_EDGE * chip;
+        int      votes = 0, touched[PP_MAX_SETS] = {0};
+        uint64_t cycles[PP_MAX_SETS];
+
+        sleep_until(begin);
+        while (mysecond() < end) {
+            unsigned m = pp_sample(r, cycles);
+            for (int k = 0; k < r->nsets; k++) touched[k] += m >> k & 1;
+            votes++;
+        }
+        for (int k = 0; k < r->nsets; k++) {
+            size_t b = i * r->nsets + k;
+            if (b >= rx->nbits) break;
+            bitvec_set(rx, b, 2 * touched[k] > votes);
+            if (llr) {
+                /* vote share with one pseudo-count each way, so no window is certain */
+                double p = (touched[k] + 0.5) / (votes + 1.0);
+                llr[b] = (float)log(p / (1.0 - p));
+            }
+        }
+    }
+    return 0;
+}
+
+int cc_loopback_start(struct cc_loopback *lb, int nsets, size_t thrash_bytes,
+                      const char *evcache, int tx_cpu, int rx_cpu, int node)
+{
+    lb->tx_cpu = tx_cpu;
+    lb->rx_cpu = rx_cpu;
+    if (rx_cpu >= 0) topology_pin_self(rx_cpu);
+    if (pp_receiver_init(&lb->rx, nsets, evcache, node) != 0) return -1;
+    if (pp_thrasher_init(&lb->tx, nsets, thrash_bytes, 0, node) != 0) {
+        pp_receiver_free(&lb->rx);
+        return -1;
+    }
+    return 0;
+}
+
+void cc_loopback_stop(struct cc_loopback *lb)
+{
+    pp_thrasher_free(&lb->tx);
+    pp_receiver_free(&lb->rx);
+}
+
+static void *transmit(void *arg)
+{
+    const struct tx_job *job = arg;
+
+    if (job->cpu >= 0) topology_pin_self(job->cpu);
+    cc_transmit(job->t, job->bits, job->chip, job->start);
+    return NULL;
+}
+
+int cc_loopback_send(struct cc_loopback *lb, const struct bitvec *bits, double chip,
+                     struct bitvec *rx, float *llr, double *start, double *done)
+{
+    struct tx_job job = { &lb->tx, bits, sync_tx_start(chip), chip, lb->tx_cpu };
+    double        timeout = SYNC_LEAD + 2 * SYNC_CHIPS * chip + 1.0;
+    double        found;
+    pthread_t     tx;
+    int           rc;
+
+    if (pthread_create(&tx, NULL, transmit, &job) != 0) {
+        perror("cache_channel: pthread_create");
+        return -1;
+    }
+    rc    = cc_receive(&lb->rx, chip, timeout, rx, llr, &found);
+    *done = mysecond();
+    pthread_join(tx, NULL);
+    *start = job.start;
+    return rc == 0 ? 0 : 1;
+}
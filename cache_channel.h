@@ -0,0 +1,61 @@
+#ifndef CACHE_CHANNEL_H
+#define CACHE_CHANNEL_H
+
+#include "primeprobe.h"
+#include "sync.h"
+#include "ecc.h"
+
+/*
+ * Clocked Prime+Probe channel (primeprobe.h) on the shared mysecond()
+ * schedule, with the bandwidth channel's framing: the 13-chip Barker
+ * preamble and SYNC_GUARD idle chips, then the payload, K bits per window
+ * with one bit per cache set.
+ *
+ * The transmitter thrashes every set during a '1' preamble chip and the
+ * sets whose payload bit is 1 during a payload window.  The receiver
+ * probes its sets back to back; for the preamble search each probe round
+ * becomes one sample of quiet/cycles averaged over the sets (1 when
+ * untouched, lower when thrashed), which sync_detect() treats exactly like
+ * a bandwidth sample.  In a payload window the first and last CC_EDGE of
+ * the window are skipped, every probe round in between is one vote per
+ * set (touched or not against its calibrated threshold), and the majority
+ * decides the bit; the vote share also gives an LLR for soft decoding.
+ *
+ * Windows are CC_CHIP by default, tens of microseconds, so K sets carry
+ * K / chip bits per second (20 kbit/s per set at 50 us).
+ */
+#define CC_CHIP 50e-6      /* seconds per window */
+#define CC_EDGE 0.1        /* fraction of a window ignored at each end */
+
+/* Windows for nbits at K bits per window. */
+size_t cc_windows(size_t nbits, int nsets);
+
+/* Preamble at start, then bits; the thrasher's sets give K. */
+void   cc_transmit(const struct pp_thrasher *t, const struct bitvec *bits, double chip, double start);
+
+/* Probes until a preamble is found or `timeout` seconds pass; 0 or -1. */
+int    cc_sync(const struct pp_receiver *r, double chip, double timeout, struct sync_result *s);
+/*
+ * cc_sync(), then one decision per payload bit into rx (sized by the
+ * caller) and, if llr is not NULL, one LLR per bit.  *start is the
+ * preamble start.  0, or -1 if no preamble was found.
+ */
+int    cc_receive(const struct pp_receiver *r, double chip, double timeout,
+                  struct bitvec *rx, float *llr, double *start);
+
+/* Both ends in one process, for bench: loopback.h for the cache channel. */
+struct cc_loopback {
+    struct pp_thrasher tx;
+    struct pp_receiver rx;
+    int                tx_cpu;      /* -1 = unpinned */
+    int                rx_cpu;
+};
+
+int  cc_loopback_start(struct cc_loopback *lb, int nsets, size_t thrash_bytes,
+                       const char *evcache, int tx_cpu, int rx_cpu, int node);
+void cc_loopback_stop(struct cc_loopback *lb);
+/* Same contract as loopback_send(). */
+int  cc_loopback_send(struct cc_loopback *lb, const struct bitvec *bits, double chip,
+                      struct bitvec *rx, float *llr, double *start, double *done);
+
+#endif
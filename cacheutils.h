@@ -0,0 +1,309 @@
+#ifndef CACHEUTILS_H
+#define CACHEUTILS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(__x86_64__) && !defined(__i386__)
+#error "cacheutils.h needs x86 (rdtsc, clflush)"
+#endif
+#include <cpuid.h>
+#include <x86intrin.h>
+
+/*
+ * Cache-timing primitives for the flush/hit channel, header-only.
+ *
+ * Timing: rdtsc alone may execute before earlier loads finish or after
+ * later ones start, so every timestamp here is fenced.
+ *
+ *   rdtsc()        lfence; rdtsc; lfence      ordered against loads
+ *   rdtsc_begin()  mfence; lfence; rdtsc; lfence
+ *                                             also waits for earlier stores
+ *                                             and flushes to complete
+ *   rdtsc_end()    rdtscp; lfence             rdtscp waits for everything
+ *                                             before it, the lfence keeps
+ *                                             later work out of the window
+ *
+ * probe() times a single load between rdtsc_begin() and rdtsc_end(); its
+ * fixed overhead is measured by cacheutils_selftest() and included in
+ * every number it returns, so compare probes with probes, not with
+ * datasheet latencies.
+ *
+ * Flushing: flush() is clflush, ordered with respect to other clflushes
+ * and writes; flush_opt() is clflushopt when the CPU has it (CPUID 7.EBX
+ * bit 23), which is weakly ordered and needs an mfence/sfence before
+ * timing.  Prefetch hints: prefetch_t0/t1/t2/nta and prefetchw.
+ *
+ * cacheutils_calibrate() times cached and freshly flushed accesses to one
+ * line, fills a histogram for each (CACHE_HIST_WIDTH cycles per bin) and
+ * derives their medians and a threshold in the valley between them
+ * (cache_hist_valley); cache_calib_save()/cache_calib_load() keep the
+ * result in a small text file.  cacheutils_selftest() runs it on a private
+ * line at startup, which tells straight away whether hits and misses
+ * separate on this machine; cacheutils_print() reports them.
+ */
+#define CACHE_HIST_BINS  256
+#define CACHE_HIST_WIDTH 4        /* cycles per bin; the last bin is open-ended */
+#define CACHE_SELFTEST_ROUNDS 20000
+
+static inline void mfence(void) { _mm_mfence(); }
+static inline void lfence(void) { _mm_lfence(); }
+static inline void sfence(void) { _mm_sfence(); }
+
+static inline uint64_t rdtsc(void)
+{
+    uint64_t t;
+    _mm_lfence();
+    t = __rdtsc();
+    _mm_lfence();
+    return t;
+}
+
+static inline uint64_t rdtsc_begin(void)
+{
+    uint64_t t;
+    _mm_mfence();
+    _mm_lfence();
+    t = __rdtsc();
+    _mm_lfence();
+    return t;
+}
+
+static inline uint64_t rdtsc_end(void)
+{
+    unsigned aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+}
+
+static inline void maccess(const void *p)
+{
+    (void)*(const volatile uint8_t *)p;
+}
+
+static inline void flush(const void *p)
+{
+    _mm_clflush(p);
+}
+
+static inline int cacheutils_has_clflushopt(void)
+{
+    static int cached = -1;
+    unsigned a, b, c, d;
+
+    if (cached < 0)
+        cached = __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1u << 23));
+    return cached;
+}
+
+/* clflushopt if available, clflush otherwise; fence before timing. */
+static inline void flush_opt(const void *p)
+{
+    if (cacheutils_has_clflushopt())
+        __asm__ volatile("clflushopt (%0)" :: "r"(p) : "memory");
+    else
+        _mm_clflush(p);
+}
+
+static inline void prefetch_t0(const void *p)  { _mm_prefetch((const char *)p, _MM_HINT_T0); }
+static inline void prefetch_t1(const void *p)  { _mm_prefetch((const char *)p, _MM_HINT_T1); }
+static inline void prefetch_t2(const void *p)  { _mm_prefetch((const char *)p, _MM_HINT_T2); }
+static inline void prefetch_nta(const void *p) { _mm_prefetch((const char *)p, _MM_HINT_NTA); }
+static inline void prefetchw(const void *p)
+{
+    __asm__ volatile("prefetchw (%0)" :: "r"(p));
+}
+
+/* Cycles for one load of p, fences included. */
+static inline uint64_t probe(const void *p)
+{
+    uint64_t t0 = rdtsc_begin();
+    maccess(p);
+    return rdtsc_end() - t0;
+}
+
+/* Flush+Reload step: time one load of p, then evict it again. */
+static inline uint64_t probe_flush(const void *p)
+{
+    uint64_t t = probe(p);
+    flush(p);
+    return t;
+}
+
+struct cache_calib {
+    uint32_t hit[CACHE_HIST_BINS];
+    uint32_t miss[CACHE_HIST_BINS];
+    uint64_t overhead;          /* median rdtsc_begin/rdtsc_end pair, cycles */
+    uint64_t hit_median;        /* cycles, probe() of a cached line */
+    uint64_t miss_median;       /* cycles, probe() of a flushed line */
+    uint64_t threshold;         /* valley between the histograms: at or above is a miss */
+};
+
+static inline void cache_hist_add(uint32_t *h, uint64_t cycles)
+{
+    uint64_t bin = cycles / CACHE_HIST_WIDTH;
+    h[bin < CACHE_HIST_BINS ? bin : CACHE_HIST_BINS - 1]++;
+}
+
+/* Cycles at the middle of the bin holding the median sample. */
+static inline uint64_t cache_hist_median(const uint32_t *h)
+{
+    uint64_t total = 0, seen = 0;
+
+    for (int i = 0; i < CACHE_HIST_BINS; i++) total += h[i];
+    for (int i = 0; i < CACHE_HIST_BINS; i++) {
+        seen += h[i];
+        if (2 * seen >= total && total)
+            return (uint64_t)i * CACHE_HIST_WIDTH + CACHE_HIST_WIDTH / 2;
+    }
+    return 0;
+}
+
+/*
+ * The decision boundary between the two histograms: the cycle count that
+ * misclassifies the fewest samples (hits at or above it plus misses below
+ * it), which sits in the valley between the peaks; among equal counts the
+ * middle of the flat stretch is taken.
+ */
+static inline uint64_t cache_hist_valley(const uint32_t *hit, const uint32_t *miss)
+{
+    uint64_t hits_above = 0, misses_below = 0, best = UINT64_MAX;
+    int      first = 1, last = 1;
+
+    for (int i = 0; i < CACHE_HIST_BINS; i++) hits_above += hit[i];
+    /* boundary b: bins below b count as hits */
+    for (int b = 1; b < CACHE_HIST_BINS; b++) {
+        hits_above   -= hit[b - 1];
+        misses_below += miss[b - 1];
+        if (hits_above + misses_below < best) {
+            best  = hits_above + misses_below;
+            first = last = b;
+        } else if (hits_above + misses_below == best && last == b - 1) {
+            last = b;
+        }
+    }
+    return (uint64_t)(first + last) * CACHE_HIST_WIDTH / 2;
+}
+
+/*
+ * Fills c from `rounds` cached and `rounds` flushed probes of `line`, and
+ * puts the threshold in the valley between them.  Returns 0 if misses come
+ * out clearly slower than hits, -1 otherwise.
+ */
+static inline int cacheutils_calibrate(struct cache_calib *c, const void *line, int rounds)
+{
+    uint32_t empty[CACHE_HIST_BINS];
+
+    memset(c, 0, sizeof(*c));
+    memset(empty, 0, sizeof(empty));
+    for (int i = 0; i < rounds; i++) {
+        uint64_t t0 = rdtsc_begin();
+        cache_hist_add(empty, rdtsc_end() - t0);
+
+        maccess(line);
+        cache_hist_add(c->hit, probe(line));
+
+        flush(line);
+        mfence();
+        cache_hist_add(c->miss, probe(line));
+    }
+
+    c->overhead    = cache_hist_median(empty);
+    c->hit_median  = cache_hist_median(c->hit);
+    c->miss_median = cache_hist_median(c->miss);
+    c->threshold   = cache_hist_valley(c->hit, c->miss);
+    return c->miss_median > c->hit_median + CACHE_HIST_WIDTH ? 0 : -1;
+}
+
+/* cacheutils_calibrate() on a private line. */
+static inline int cacheutils_selftest(struct cache_calib *c, int rounds)
+{
+    uint8_t *line = aligned_alloc(4096, 4096);
+    int      rc;
+
+    if (!line) {
+        memset(c, 0, sizeof(*c));
+        perror("cacheutils: aligned_alloc");
+        return -1;
+    }
+    memset(line, 1, 4096);
+    rc = cacheutils_calibrate(c, line, rounds);
+    free(line);
+    return rc;
+}
+
+/*
+ * Text file: a "cache_calib 1" line, the four summary values, then one
+ * "bin <start cycles> <hits> <misses>" line per non-empty bin.
+ */
+static inline int cache_calib_save(const char *path, const struct cache_calib *c)
+{
+    FILE *f = fopen(path, "w");
+
+    if (!f) { perror(path); return -1; }
+    fprintf(f, "cache_calib 1\noverhead %llu\nhit %llu\nmiss %llu\nthreshold %llu\n",
+            (unsigned long long)c->overhead, (unsigned long long)c->hit_median,
+            (unsigned long long)c->miss_median, (unsigned long long)c->threshold);
+    for (int i = 0; i < CACHE_HIST_BINS; i++)
+        if (c->hit[i] || c->miss[i])
+            fprintf(f, "bin %d %u %u\n", i * CACHE_HIST_WIDTH, c->hit[i], c->miss[i]);
+    if (fclose(f) != 0) { perror(path); return -1; }
+    return 0;
+}
+
+/* 0, or -1 if the file is missing or not a calibration (c is then zeroed). */
+static inline int cache_calib_load(const char *path, struct cache_calib *c)
+{
+    FILE              *f = fopen(path, "r");
+    unsigned long long o, h, m, t;
+    int                version, start;
+    unsigned           nh, nm;
+
+    memset(c, 0, sizeof(*c));
+    if (!f) return -1;
+    if (fscanf(f, "cache_calib %d overhead %llu hit %llu miss %llu threshold %llu",
+               &version, &o, &h, &m, &t) != 5 || version != 1) {
+        fprintf(stderr, "cacheutils: %s: not a calibration file\n", path);
+        fclose(f);
+        return -1;
+    }
+    c->overhead    = o;
+    c->hit_median  = h;
+    c->miss_median = m;
+    c->threshold   = t;
+    while (fscanf(f, " bin %d %u %u", &start, &nh, &nm) == 3) {
+        if (start < 0 || start / CACHE_HIST_WIDTH >= CACHE_HIST_BINS) continue;
+        c->hit[start / CACHE_HIST_WIDTH]  = nh;
+        c->miss[start / CACHE_HIST_WIDTH] = nm;
+    }
+    fclose(f);
+    return 0;
+}
+
+/* One summary line, plus the non-empty histogram bins when `hist` is set. */
+static inline void cacheutils_print(const struct cache_calib *c, const char *who,
+                                    int hist, FILE *f)
+{
+    fprintf(f, "%s: timer overhead %llu, hit %llu, miss %llu cycles => threshold %llu%s\n",
+            who, (unsigned long long)c->overhead, (unsigned long long)c->hit_median,
+            (unsigned long long)c->miss_median, (unsigned long long)c->threshold,
+            cacheutils_has_clflushopt() ? " (clflushopt available)" : "");
+    if (!hist) return;
+
+    fprintf(f, "%s: %9s %10s %10s\n", who, "cycles", "hit", "miss");
+    for (int i = 0; i < CACHE_HIST_BINS; i++) {
+        char range[24];
+        if (!c->hit[i] && !c->miss[i]) continue;
+        if (i < CACHE_HIST_BINS - 1)
+            snprintf(range, sizeof(range), "%d-%d", i * CACHE_HIST_WIDTH,
+                     (i + 1) * CACHE_HIST_WIDTH - 1);
+        else
+            snprintf(range, sizeof(range), ">=%d", i * CACHE_HIST_WIDTH);
+        fprintf(f, "%s: %9s %10u %10u\n", who, range, c->hit[i], c->miss[i]);
+    }
+}
+
+#endif
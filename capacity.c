@@ -0,0 +1,249 @@
+/*
+ * Channel characterization: bit error rates and capacity versus symbol rate.
+ *
+ * For every rate R of a ladder (--rates, symbols per second) the loopback
+ * link (loopback.h) sends --bits of a pseudo-random binary sequence
+ * (ITU-T O.150 PRBS, --prbs) --repeats times, and compares the receiver's
+ * decisions with the known sequence.  That gives the two crossover
+ * probabilities of the binary channel,
+ *
+ *   p01 = P(read 1 | sent 0)        p10 = P(read 0 | sent 1),
+ *
+ * and, from their mean p, the binary symmetric channel capacity
+ *
+ *   C = R * (1 - H(p))  bit/s.
+ *
+ * C is also given with its 95% confidence half-width over the repeats, and
+ * next to it the capacity of the asymmetric channel (best input
+ * distribution for the measured p01 and p10), which is what a code
+ * matched to the asymmetry could reach.  The rate with the largest C is
+ * the measured operating point, BIT_DURATION = 1 / R.  A run whose
+ * preamble is not found counts as C = 0 and adds nothing to p01 and p10.
+ *
+ *  gcc -fopenmp -O3 -pthread capacity.c loopback.c contention_pool.c stream_sampler.c robust.c \
+ *      sync.c level_tracker.c ecc.c conv.c stats.c topology.c hugemem.c kernels.c \
+ *      timing.c -o capacity -lm
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "timing.h"
+#include "topology.h"
+#include "loopback.h"
+#include "level_tracker.h"
+#include "ecc.h"
+#include "stats.h"
+
+#define SAMPLER_ELEMS   500000
+#define MAX_RATES       32
+#define DEFAULT_RATES   "5,10,20,50,100,200,500,1000"
+#define DEFAULT_BITS    256
+#define DEFAULT_REPEATS 3
+#define DEFAULT_PRBS    9
+
+struct prbs {
+    uint32_t state;
+    int      a, b;      /* taps: x^a + x^b + 1 */
+};
+
+struct rate_result {
+    double         rate;
+    int            runs, sync_failures;
+    long           sent0, sent1, e01, e10;
+    double         p01, p10, p;
+    struct summary c_bsc;      /* bit/s */
+    double         c_bac;      /* bit/s, pooled p01 and p10, failed runs as 0 */
+};
+
+static struct loopback lb;
+
+static int prbs_init(struct prbs *g, int order)
+{
+    static const int taps[][2] = { {7, 6}, {9, 5}, {15, 14}, {23, 18}, {31, 28} };
+
+    for (size_t i = 0; i < sizeof(taps) / sizeof(taps[0]); i++) {
+        if (taps[i][0] != order) continue;
+        g->a     = taps[i][0];
+        g->b     = taps[i][1];
+        g->state = (uint32_t)((1ull << order) - 1);
+        return 0;
+    }
+    fprintf(stderr, "capacity: no PRBS-%d, use 7, 9, 15, 23 or 31\n", order);
+    return -1;
+}
+
+static int prbs_next(struct prbs *g)
+{
+    int bit = ((g->state >> (g->a - 1)) ^ (g->state >> (g->b - 1))) & 1;
+    g->state = ((g->state << 1) | (uint32_t)bit) & (uint32_t)((1ull << g->a) - 1);
+    return bit;
+}
+
+static int measure_rate(struct rate_result *r, struct prbs *g, int bits, int repeats)
+{
+    struct bitvec tx, rx;
+    double        c[repeats], start, done;
+    double        chip = 1.0 / r->rate;
+
+    if (bitvec_init(&tx, bits) != 0) return -1;
+    if (bitvec_init(&rx, bits) != 0) { bitvec_free(&tx); return -1; }
+
+    for (int k = 0; k < repeats; k++) {
+        long   n0 = 0, n1 = 0, e01 = 0, e10 = 0;
+        int    sent;
+        double p01, p10;
+
+        for (int i = 0; i < bits; i++) bitvec_set(&tx, i, prbs_next(g));
+        sent = loopback_send(&lb, &tx, chip, &rx, NULL, &start, &done);
+        if (sent < 0) break;
+
+        for (int i = 0; i < bits && sent == 0; i++) {
+            int s = bitvec_get(&tx, i), d = bitvec_get(&rx, i);
+            if (s) { n1++; e10 += !d; }
+            else   { n0++; e01 +=  d; }
+        }
+        p01  = n0 ? (double)e01 / n0 : 0.5;
+        p10  = n1 ? (double)e10 / n1 : 0.5;
+        c[k] = sent ? 0.0 : r->rate * stats_bsc_capacity(0.5 * (p01 + p10));
+
+        r->sent0 += n0;  r->e01 += e01;
+        r->sent1 += n1;  r->e10 += e10;
+        r->sync_failures += sent == 1;
+        r->runs++;
+        fprintf(stderr, "capacity: %g sym/s run %d/%d: %s, p01 %.4f, p10 %.4f, C %.2f bit/s\n",
+                r->rate, k + 1, repeats, sent ? "no preamble" : "synced",
+                p01, p10, c[k]);
+    }
+    bitvec_free(&rx);
+    bitvec_free(&tx);
+    if (r->runs < repeats) return -1;
+
+    /* with no synced run there is nothing to count: call it a coin flip */
+    r->p01   = r->sent0 ? (double)r->e01 / r->sent0 : 0.5;
+    r->p10   = r->sent1 ? (double)r->e10 / r->sent1 : 0.5;
+    r->p     = 0.5 * (r->p01 + r->p10);
+    r->c_bac = r->rate * stats_bac_capacity(r->p01, r->p10)
+             * (r->runs - r->sync_failures) / r->runs;
+    stats_summarize(c, repeats, &r->c_bsc);
+    return 0;
+}
+
+static void write_table(FILE *f, const struct rate_result *r, int n, int best)
+{
+    fprintf(f, "%9s %10s %5s %5s  %8s %8s %8s  %12s %10s %12s\n", "sym/s", "bit s",
+            "runs", "nosyn", "p01", "p10", "p", "C_bsc bit/s", "+-95%", "C_bac bit/s");
+    for (int i = 0; i < n; i++)
+        fprintf(f, "%9g %10.6f %5d %5d  %8.5f %8.5f %8.5f  %12.3f %10.3f %12.3f%s\n",
+                r[i].rate, 1.0 / r[i].rate, r[i].runs, r[i].sync_failures,
+                r[i].p01, r[i].p10, r[i].p, r[i].c_bsc.mean,
+                isnan(r[i].c_bsc.ci) ? 0.0 : r[i].c_bsc.ci, r[i].c_bac,
+                i == best ? "  <- best" : "");
+}
+
+static int write_csv(const char *path, const struct rate_result *r, int n)
+{
+    FILE *f = fopen(path, "w");
+
+    if (!f) { perror(path); return -1; }
+    fprintf(f, "rate,bit_duration,runs,sync_failures,p01,p10,p,c_bsc,c_bsc_ci,c_bac\n");
+    for (int i = 0; i < n; i++)
+        fprintf(f, "%g,%.9f,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n", r[i].rate,
+                1.0 / r[i].rate, r[i].runs, r[i].sync_failures, r[i].p01, r[i].p10,
+                r[i].p, r[i].c_bsc.mean, isnan(r[i].c_bsc.ci) ? 0.0 : r[i].c_bsc.ci,
+                r[i].c_bac);
+    if (fclose(f) != 0) { perror(path); return -1; }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    timing_init();
+
+    char        rates[256] = DEFAULT_RATES;
+    int         bits     = DEFAULT_BITS;
+    int         repeats  = DEFAULT_REPEATS;
+    int         order    = DEFAULT_PRBS;
+    int         nthreads = 0;
+    long        elems    = SAMPLER_ELEMS;
+    double      period   = 0.0;
+    double      alpha    = LEVEL_ALPHA;
+    const char *tx_cpus  = NULL;
+    const char *rx_cpus  = NULL;
+    int         node     = -1;
+    const char *kernel   = NULL;
+    const char *csv      = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--rates")     == 0 && i+1 < argc) snprintf(rates, sizeof(rates), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--bits")      == 0 && i+1 < argc) bits     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repeats")   == 0 && i+1 < argc) repeats  = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--prbs")      == 0 && i+1 < argc) order    = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--alpha")     == 0 && i+1 < argc) alpha    = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads")   == 0 && i+1 < argc) nthreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--elems")     == 0 && i+1 < argc) elems    = atol(argv[++i]);
+        else if (strcmp(argv[i], "--sample-period") == 0 && i+1 < argc) period = atof(argv[++i]);
+        else if (strcmp(argv[i], "--tx-cpus")   == 0 && i+1 < argc) tx_cpus  = argv[++i];
+        else if (strcmp(argv[i], "--rx-cpus")   == 0 && i+1 < argc) rx_cpus  = argv[++i];
+        else if (strcmp(argv[i], "--node")      == 0 && i+1 < argc) node     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--kernel")    == 0 && i+1 < argc) kernel   = argv[++i];
+        else if (strcmp(argv[i], "--csv")       == 0 && i+1 < argc) csv      = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--rates r,r,...] [--bits n] [--repeats n] [--prbs 7|9|15|23|31]\n"
+                            "       [--tx-cpus LIST] [--rx-cpus LIST] [--node N] [--threads n] [--kernel K]\n"
+                            "       [--elems n | --sample-period s] [--alpha a] [--csv FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    struct rate_result r[MAX_RATES];
+    struct prbs        g;
+    int                n = 0;
+
+    memset(r, 0, sizeof(r));
+    for (char *tok = strtok(rates, ","); tok; tok = strtok(NULL, ",")) {
+        if (n == MAX_RATES || (r[n].rate = atof(tok)) <= 0.0) {
+            fprintf(stderr, "capacity: bad rate list (at most %d positive rates)\n", MAX_RATES);
+            return 1;
+        }
+        n++;
+    }
+    if (n < 1 || bits < 1 || repeats < 1) {
+        fprintf(stderr, "capacity: need at least one rate, --bits >= 1 and --repeats >= 1\n");
+        return 1;
+    }
+    if (prbs_init(&g, order) != 0) return 1;
+
+    static struct placement tx, rx;
+    const struct mem_kernel *k = kernel_select(kernel);
+    if (!k || placement_init(&tx, tx_cpus, node) != 0 || placement_init(&rx, rx_cpus, node) != 0)
+        return 1;
+    if (!tx.ncpus) placement_online(&tx);
+    if (nthreads < 1) nthreads = tx.ncpus;
+    placement_print(&tx, "capacity: transmitter", stdout);
+    placement_print(&rx, "capacity: receiver", stdout);
+
+    if (loopback_start(&lb, nthreads, &tx, &rx, k, (size_t)elems, period) != 0) return 1;
+    lb.alpha = alpha;
+    printf("capacity: %d worker(s), %s kernel, sampler %.3f ms per pass, PRBS-%d, %d bits x %d per rate\n\n",
+           nthreads, k->name, 1e3 * lb.sampler.last_pass, order, bits, repeats);
+    fflush(stdout);
+
+    int rc = 0, done = 0, best = -1;
+    for (; done < n; done++) {
+        if (measure_rate(&r[done], &g, bits, repeats) != 0) { rc = 1; break; }
+        if (r[done].c_bsc.mean > (best < 0 ? 0.0 : r[best].c_bsc.mean)) best = done;
+    }
+    loopback_stop(&lb);
+
+    write_table(stdout, r, done, best);
+    if (best >= 0)
+        printf("\ncapacity: best rate %g sym/s (BIT_DURATION = %.6f s): C = %.3f bit/s, "
+               "p01 = %.4f, p10 = %.4f\n", r[best].rate, 1.0 / r[best].rate,
+               r[best].c_bsc.mean, r[best].p01, r[best].p10);
+    else if (done)
+        printf("\ncapacity: no rate carried any information\n");
+    if (csv && write_csv(csv, r, done) != 0) rc = 1;
+    return rc;
+}
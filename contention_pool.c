@@ -0,0 +1,158 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include "contention_pool.h"
+#include "topology.h"
+#include "hugemem.h"
+#include "timing.h"
+
+/* elements copied between two looks at the gate (16 KiB per array) */
+#define CHUNK_ELEMS 2048
+/* idle spins before the worker parks on the gate */
+#define IDLE_SPINS  4096
+
+/* Sleeps while *gate still holds `seen`; returns at once if it has moved. */
+static void gate_wait(atomic_int *gate, int seen)
+{
+    syscall(SYS_futex, (int *)gate, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+}
+
+static void gate_store(struct contention_pool *p, int value)
+{
+    if (atomic_exchange_explicit(&p->gate, value, memory_order_release) != value)
+        syscall(SYS_futex, (int *)&p->gate, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static void *contention_worker_main(void *arg)
+{
+    struct contention_worker *w = arg;
+    struct contention_pool   *p = w->pool;
+    size_t n = p->elems, j = 0, k;
+    int    idle = 0;
+
+    topology_pin_self(w->cpu);
+
+    /* allocated and pre-faulted on the pinned core, so pages stay local */
+    if (hugemem_alloc(&w->ma, n * sizeof(double), HUGEMEM_HUGETLB, p->node) != 0 ||
+        hugemem_alloc(&w->mc, n * sizeof(double), HUGEMEM_HUGETLB, p->node) != 0) {
+        w->failed = 1;
+        atomic_fetch_add(&p->ready, 1);
+        return NULL;
+    }
+    w->a = w->ma.p;
+    w->c = w->mc.p;
+    for (k = 0; k < n; k++) {
+        w->a[k] = 1.0;
+        w->c[k] = 0.0;
+    }
+    atomic_fetch_add(&p->ready, 1);
+
+    while (atomic_load_explicit(&p->running, memory_order_relaxed)) {
+        int gate = atomic_load_explicit(&p->gate, memory_order_acquire);
+        if (gate <= w->index) {
+            /* pause through a short gap, so a quick edge is seen in ns; then park */
+            if (++idle < IDLE_SPINS) _mm_pause();
+            else gate_wait(&p->gate, gate);
+            continue;
+        }
+        idle = 0;
+
+        size_t end = j + CHUNK_ELEMS;
+        if (end > n) end = n;
+        p->kernel->run(w->c + j, w->a + j, end - j);
+        j = (end == n) ? 0 : end;
+    }
+    return NULL;
+}
+
+int contention_pool_start(struct contention_pool *p, int nthreads, size_t elems,
+                          const struct placement *pl)
+{
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int  i;
+
+    memset(p, 0, sizeof(*p));
+    if (nthreads < 1) nthreads = 1;
+    p->nthreads = nthreads;
+    p->elems    = elems;
+    p->node     = pl ? pl->node : -1;
+    p->kernel   = kernel_select(NULL);
+    atomic_store(&p->gate, 0);
+    atomic_store(&p->running, 1);
+    atomic_store(&p->ready, 0);
+
+    p->workers = calloc(nthreads, sizeof(*p->workers));
+    if (!p->workers) { perror("contention_pool: calloc"); return -1; }
+
+    for (i = 0; i < nthreads; i++) {
+        struct contention_worker *w = &p->workers[i];
+        w->pool  = p;
+        w->index = i;
+        w->cpu   = placement_cpu(pl, i);
+        if (w->cpu < 0 && ncpu > 0) w->cpu = (int)(i % ncpu);
+        if (pthread_create(&w->thread, NULL, contention_worker_main, w) != 0) {
+            perror("contention_pool: pthread_create");
+            p->nthreads = i;
+            contention_pool_stop(p);
+            return -1;
+        }
+    }
+
+    while (atomic_load(&p->ready) < nthreads)
+        usleep(100);
+    for (i = 0; i < nthreads; i++) {
+        if (p->workers[i].failed) {
+            contention_pool_stop(p);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void contention_pool_set_kernel(struct contention_pool *p, const struct mem_kernel *k)
+{
+    p->kernel = k;
+}
+
+void contention_pool_set(struct contention_pool *p, int on)
+{
+    gate_store(p, on ? p->nthreads : 0);
+}
+
+void contention_pool_set_level(struct contention_pool *p, int active)
+{
+    if (active < 0)           active = 0;
+    if (active > p->nthreads) active = p->nthreads;
+    gate_store(p, active);
+}
+
+void contention_pool_chip(void *pool, double end)
+{
+    contention_pool_set(pool, 1);
+    sleep_until(end);
+    contention_pool_set(pool, 0);
+}
+
+void contention_pool_stop(struct contention_pool *p)
+{
+    int i;
+
+    /* a gate value no worker parks on, so every sleeper wakes and sees running = 0 */
+    atomic_store(&p->running, 0);
+    gate_store(p, -1);
+    for (i = 0; i < p->nthreads; i++) {
+        struct contention_worker *w = &p->workers[i];
+        pthread_join(w->thread, NULL);
+        hugemem_free(&w->ma);
+        hugemem_free(&w->mc);
+    }
+    free(p->workers);
+    p->workers  = NULL;
+    p->nthreads = 0;
+}
@@ -0,0 +1,69 @@
+#ifndef CONTENTION_POOL_H
+#define CONTENTION_POOL_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "hugemem.h"
+#include "kernels.h"
+
+/*
+ * Persistent memory-contention generator used by the transmitters.
+ *
+ * Worker threads are started once, pinned to a core, and allocate and
+ * pre-fault their own copy buffers there (huge pages when available).
+ * After that they only look at `gate`, the number of workers that should
+ * be active: worker i runs the selected memory kernel (kernels.h) in short
+ * chunks while i < gate.  Otherwise it spins on pause for IDLE_SPINS
+ * rounds, so an edge shortly after the last one is seen within
+ * nanoseconds, and then sleeps on a futex on `gate` and leaves its core
+ * free.  Changing the gate is one atomic exchange, plus a futex wake when
+ * the value moved, so the symbol edge follows the schedule instead of
+ * fork/exec and page-fault latency, and intermediate values give
+ * intermediate contention levels.
+ */
+struct contention_worker {
+    struct contention_pool *pool;
+    int             index;
+    pthread_t       thread;
+    int             cpu;
+    int             failed;     /* buffer allocation failed */
+    struct hugemem  ma, mc;
+    double         *a;
+    double         *c;
+};
+
+struct contention_pool {
+    int                       nthreads;
+    size_t                    elems;     /* elements per worker array */
+    int                       node;      /* NUMA node for buffers, -1 = default */
+    const struct mem_kernel  *kernel;    /* what active workers run */
+    struct contention_worker *workers;
+    atomic_int                gate;      /* workers hammering, 0 = idle */
+    atomic_int                running;
+    atomic_int                ready;     /* workers done pre-faulting */
+};
+
+struct placement;
+
+/*
+ * Worker i runs on placement_cpu(pl, i) and its buffers are bound to
+ * pl->node; with pl == NULL (or no CPUs listed) workers go round-robin
+ * over the online CPUs and memory follows the default policy.
+ */
+int  contention_pool_start(struct contention_pool *p, int nthreads, size_t elems,
+                           const struct placement *pl);
+/* Kernel the workers run when active; set it while the gate is closed. */
+void contention_pool_set_kernel(struct contention_pool *p, const struct mem_kernel *k);
+void contention_pool_set(struct contention_pool *p, int on);
+/* Activates `active` of the workers (clamped to 0..nthreads). */
+void contention_pool_set_level(struct contention_pool *p, int active);
+/*
+ * Every worker hammers until mysecond() reaches `end`, then the gate
+ * closes.  Takes the pool as void * so it can be passed straight to
+ * sync_send_preamble() as the '1' chip.
+ */
+void contention_pool_chip(void *pool, double end);
+void contention_pool_stop(struct contention_pool *p);
+
+#endif
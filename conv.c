@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <string.h>
+#include "conv.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX_KERNEL 1
+#endif
+
+#define CONV_G0   0x79      /* 171 octal */
+#define CONV_G1   0x5b      /* 133 octal */
+#define CONV_NEG  -1.0e9f
+#define RENORM    256       /* steps between metric renormalizations */
+
+/*
+ * Branch output index (o0 | o1 << 1) for the shift register sr, where
+ * bit 0 is the newest input and bit 6 the oldest.  For new state ns and
+ * predecessor high bit b, sr = (b << 6) | ns.
+ */
+static int     out_idx[128];
+static int32_t idx_even0[32], idx_even1[32], idx_odd0[32], idx_odd1[32];
+static int     tables_ready;
+
+static void conv_tables(void)
+{
+    if (tables_ready) return;
+    for (int sr = 0; sr < 128; sr++)
+        out_idx[sr] = __builtin_parity(sr & CONV_G0) |
+                      (__builtin_parity(sr & CONV_G1) << 1);
+    for (int i = 0; i < 32; i++) {
+        idx_even0[i] = out_idx[2 * i];
+        idx_even1[i] = out_idx[64 | (2 * i)];
+        idx_odd0[i]  = out_idx[2 * i + 1];
+        idx_odd1[i]  = out_idx[64 | (2 * i + 1)];
+    }
+    tables_ready = 1;
+}
+
+void conv_encoder_init(struct conv_encoder *e)
+{
+    conv_tables();
+    e->state = 0;
+}
+
+void conv_encode_bit(struct conv_encoder *e, int bit, int out[2])
+{
+    unsigned sr = ((e->state << 1) | (bit & 1)) & 0x7f;
+    out[0] = out_idx[sr] & 1;
+    out[1] = out_idx[sr] >> 1;
+    e->state = sr & (CONV_STATES - 1);
+}
+
+void conv_decoder_init(struct conv_decoder *d, void (*emit)(void *arg, int bit),
+                       void *arg)
+{
+    conv_tables();
+    memset(d, 0, sizeof(*d));
+    for (int s = 1; s < CONV_STATES; s++)
+        d->metric[s] = CONV_NEG;
+    d->emit = emit;
+    d->arg  = arg;
+}
+
+/* bm[idx] for the four possible output pairs */
+static void branch_metrics(const float *llr, float bm[4])
+{
+    bm[0] = -llr[0] - llr[1];
+    bm[1] =  llr[0] - llr[1];
+    bm[2] = -llr[0] + llr[1];
+    bm[3] =  llr[0] + llr[1];
+}
+
+static void acs_scalar(struct conv_decoder *d, const float bm[4],
+                       struct conv_decision *out)
+{
+    uint32_t even = 0, odd = 0;
+
+    for (int i = 0; i < 32; i++) {
+        float lo = d->metric[i], hi = d->metric[i + 32];
+        float e0 = lo + bm[idx_even0[i]], e1 = hi + bm[idx_even1[i]];
+        float o0 = lo + bm[idx_odd0[i]],  o1 = hi + bm[idx_odd1[i]];
+
+        if (e1 > e0) { d->next[2 * i]     = e1; even |= 1u << i; }
+        else           d->next[2 * i]     = e0;
+        if (o1 > o0) { d->next[2 * i + 1] = o1; odd  |= 1u << i; }
+        else           d->next[2 * i + 1] = o0;
+    }
+    out->even = even;
+    out->odd  = odd;
+}
+
+#ifdef HAVE_AVX_KERNEL
+__attribute__((target("avx")))
+static void acs_avx(struct conv_decoder *d, const float bm[4],
+                    struct conv_decision *out)
+{
+    __m256   tbl  = _mm256_setr_ps(bm[0], bm[1], bm[2], bm[3],
+                                   bm[0], bm[1], bm[2], bm[3]);
+    uint32_t even = 0, odd = 0;
+
+    for (int i = 0; i < 32; i += 8) {
+        __m256 lo = _mm256_load_ps(&d->metric[i]);
+        __m256 hi = _mm256_load_ps(&d->metric[i + 32]);
+
+        __m256 e0 = _mm256_add_ps(lo, _mm256_permutevar_ps(tbl,
+                        _mm256_loadu_si256((const __m256i *)&idx_even0[i])));
+        __m256 e1 = _mm256_add_ps(hi, _mm256_permutevar_ps(tbl,
+                        _mm256_loadu_si256((const __m256i *)&idx_even1[i])));
+        __m256 o0 = _mm256_add_ps(lo, _mm256_permutevar_ps(tbl,
+                        _mm256_loadu_si256((const __m256i *)&idx_odd0[i])));
+        __m256 o1 = _mm256_add_ps(hi, _mm256_permutevar_ps(tbl,
+                        _mm256_loadu_si256((const __m256i *)&idx_odd1[i])));
+
+        __m256 ce = _mm256_cmp_ps(e1, e0, _CMP_GT_OQ);
+        __m256 co = _mm256_cmp_ps(o1, o0, _CMP_GT_OQ);
+        __m256 e  = _mm256_blendv_ps(e0, e1, ce);
+        __m256 o  = _mm256_blendv_ps(o0, o1, co);
+
+        even |= (uint32_t)_mm256_movemask_ps(ce) << i;
+        odd  |= (uint32_t)_mm256_movemask_ps(co) << i;
+
+        /* interleave back to state order 2i, 2i+1, ... */
+        __m256 a = _mm256_unpacklo_ps(e, o);
+        __m256 b = _mm256_unpackhi_ps(e, o);
+        _mm256_store_ps(&d->next[2 * i],     _mm256_permute2f128_ps(a, b, 0x20));
+        _mm256_store_ps(&d->next[2 * i + 8], _mm256_permute2f128_ps(a, b, 0x31));
+    }
+    out->even = even;
+    out->odd  = odd;
+}
+#endif
+
+typedef void (*acs_fn)(struct conv_decoder *, const float *, struct conv_decision *);
+
+static acs_fn pick_acs(void)
+{
+#ifdef HAVE_AVX_KERNEL
+    if (__builtin_cpu_supports("avx")) return acs_avx;
+#endif
+    return acs_scalar;
+}
+
+static int pred(int s, const struct conv_decision *dc)
+{
+    int i = s >> 1;
+    int b = (s & 1) ? (dc->odd >> i) & 1 : (dc->even >> i) & 1;
+    return i | (b << 5);
+}
+
+/* Traces back from state s at step steps-1 and emits the oldest n bits. */
+static void traceback(struct conv_decoder *d, int s, size_t n)
+{
+    int    bits[CONV_RING];
+    size_t t = d->steps;
+
+    while (t-- > d->emitted) {
+        if (t < d->emitted + n) bits[t - d->emitted] = s & 1;
+        s = pred(s, &d->dec[t % CONV_RING]);
+    }
+    for (size_t k = 0; k < n; k++)
+        d->emit(d->arg, bits[k]);
+    d->emitted += n;
+}
+
+void conv_decoder_push(struct conv_decoder *d, const float *llr, size_t steps)
+{
+    static acs_fn acs;
+    if (!acs) acs = pick_acs();
+
+    for (size_t k = 0; k < steps; k++) {
+        float bm[4];
+        branch_metrics(llr + 2 * k, bm);
+        acs(d, bm, &d->dec[d->steps % CONV_RING]);
+        memcpy(d->metric, d->next, sizeof(d->metric));
+        d->steps++;
+
+        if (d->steps % RENORM == 0) {
+            float top = d->metric[0];
+            for (int s = 1; s < CONV_STATES; s++)
+                if (d->metric[s] > top) top = d->metric[s];
+            for (int s = 0; s < CONV_STATES; s++)
+                d->metric[s] -= top;
+        }
+
+        if (d->steps - d->emitted == CONV_RING) {
+            int best = 0;
+            for (int s = 1; s < CONV_STATES; s++)
+                if (d->metric[s] > d->metric[best]) best = s;
+            traceback(d, best, CONV_BLOCK);
+        }
+    }
+}
+
+void conv_decoder_finish(struct conv_decoder *d)
+{
+    traceback(d, 0, d->steps - d->emitted);
+}
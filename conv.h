@@ -0,0 +1,53 @@
+#ifndef CONV_H
+#define CONV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Rate-1/2, K=7 convolutional code (generators 171, 133 octal) with a
+ * streaming soft-decision Viterbi decoder.
+ *
+ * The encoder appends K-1 zero tail bits, so n data bits become
+ * 2 * (n + 6) coded bits.  The decoder takes one LLR pair per step
+ * (log P(1)/P(0), as from level_tracker_llr()), runs the 64-state
+ * add-compare-select with AVX when the CPU has it, and emits decided bits
+ * through a callback every CONV_BLOCK steps using a CONV_TRACEBACK-step
+ * traceback, so memory stays constant however long the payload is.
+ */
+#define CONV_K         7
+#define CONV_STATES    64
+#define CONV_TRACEBACK 64
+#define CONV_BLOCK     64
+#define CONV_RING      (CONV_TRACEBACK + CONV_BLOCK)
+
+struct conv_encoder {
+    unsigned state;
+};
+
+struct conv_decision {
+    uint32_t even;      /* bit i: survivor of state 2i came from i + 32 */
+    uint32_t odd;       /* bit i: same for state 2i + 1 */
+};
+
+struct conv_decoder {
+    float                metric[CONV_STATES] __attribute__((aligned(32)));
+    float                next[CONV_STATES]   __attribute__((aligned(32)));
+    struct conv_decision dec[CONV_RING];
+    size_t               steps;     /* LLR pairs consumed */
+    size_t               emitted;   /* bits handed to emit() */
+    void               (*emit)(void *arg, int bit);
+    void                *arg;
+};
+
+void conv_encoder_init(struct conv_encoder *e);
+/* Encodes one bit into two coded bits out[0], out[1]. */
+void conv_encode_bit(struct conv_encoder *e, int bit, int out[2]);
+
+void conv_decoder_init(struct conv_decoder *d, void (*emit)(void *arg, int bit),
+                       void *arg);
+void conv_decoder_push(struct conv_decoder *d, const float *llr, size_t steps);
+/* Flushes the remaining bits, tracing back from the zero tail state. */
+void conv_decoder_finish(struct conv_decoder *d);
+
+#endif
@@ -0,0 +1,510 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ecc.h"
+#include "conv.h"
+
+#define SECDED_DATA 64
+#define SECDED_POS  72      /* overall parity at 0, Hamming positions 1..71 */
+#define CHASE_BITS  3       /* least reliable bits flipped by the soft SECDED search */
+
+int bitvec_init(struct bitvec *bv, size_t nbits)
+{
+    size_t words = (nbits + 63) / 64;
+    bv->w     = calloc(words ? words : 1, sizeof(uint64_t));
+    bv->nbits = nbits;
+    if (!bv->w) { perror("bitvec: calloc"); return -1; }
+    return 0;
+}
+
+void bitvec_free(struct bitvec *bv)
+{
+    free(bv->w);
+    bv->w     = NULL;
+    bv->nbits = 0;
+}
+
+int bitvec_from_string(struct bitvec *bv, const char *bits)
+{
+    size_t n = strlen(bits);
+    if (bitvec_init(bv, n) != 0) return -1;
+    for (size_t i = 0; i < n; i++)
+        if (bits[i] == '1') bitvec_set(bv, i, 1);
+    return 0;
+}
+
+void bitvec_to_string(const struct bitvec *bv, char *out)
+{
+    for (size_t i = 0; i < bv->nbits; i++)
+        out[i] = bitvec_get(bv, i) ? '1' : '0';
+    out[bv->nbits] = '\0';
+}
+
+/* ---- repetition-N ---------------------------------------------------- */
+
+static size_t rep_len(const struct ecc_code *c, size_t nbits)
+{
+    return nbits * c->n;
+}
+
+static void rep_encode(const struct ecc_code *c, const struct bitvec *in,
+                       struct bitvec *out)
+{
+    for (size_t i = 0; i < in->nbits; i++)
+        if (bitvec_get(in, i))
+            for (int r = 0; r < c->n; r++)
+                bitvec_set(out, i * c->n + r, 1);
+}
+
+static void rep_decode(const struct ecc_code *c, const struct bitvec *in,
+                       struct bitvec *out, struct ecc_stats *st)
+{
+    for (size_t i = 0; i < out->nbits; i++) {
+        int ones = 0;
+        for (int r = 0; r < c->n; r++)
+            ones += bitvec_get(in, i * c->n + r);
+        int bit = ones > c->n / 2;
+        bitvec_set(out, i, bit);
+        st->corrected += bit ? c->n - ones : ones;
+    }
+}
+
+static void rep_decode_soft(const struct ecc_code *c, const float *llr,
+                            struct bitvec *out, struct ecc_stats *st)
+{
+    for (size_t i = 0; i < out->nbits; i++) {
+        double sum = 0.0;
+        for (int r = 0; r < c->n; r++)
+            sum += llr[i * c->n + r];
+        int bit = sum > 0.0;
+        bitvec_set(out, i, bit);
+        for (int r = 0; r < c->n; r++)
+            if ((llr[i * c->n + r] > 0.0) != bit) st->corrected++;
+    }
+}
+
+/* ---- Hamming(7,4) ---------------------------------------------------- */
+
+static size_t h74_len(const struct ecc_code *c, size_t nbits)
+{
+    (void)c;
+    return (nbits + 3) / 4 * 7;
+}
+
+/* codeword positions 1..7: p1 p2 d1 p3 d2 d3 d4 */
+static const int h74_data_pos[4] = { 3, 5, 6, 7 };
+
+static void h74_encode(const struct ecc_code *c, const struct bitvec *in,
+                       struct bitvec *out)
+{
+    (void)c;
+    for (size_t b = 0; b * 4 < in->nbits; b++) {
+        int cw[8] = { 0 }, k;
+
+        for (k = 0; k < 4 && b * 4 + k < in->nbits; k++)
+            cw[h74_data_pos[k]] = bitvec_get(in, b * 4 + k);
+        cw[1] = cw[3] ^ cw[5] ^ cw[7];
+        cw[2] = cw[3] ^ cw[6] ^ cw[7];
+        cw[4] = cw[5] ^ cw[6] ^ cw[7];
+
+        for (k = 1; k <= 7; k++)
+            bitvec_set(out, b * 7 + k - 1, cw[k]);
+    }
+}
+
+static void h74_decode(const struct ecc_code *c, const struct bitvec *in,
+                       struct bitvec *out, struct ecc_stats *st)
+{
+    (void)c;
+    for (size_t b = 0; b * 4 < out->nbits; b++) {
+        int cw[8] = { 0 }, syn = 0, k;
+
+        for (k = 1; k <= 7; k++) {
+            cw[k] = bitvec_get(in, b * 7 + k - 1);
+            if (cw[k]) syn ^= k;
+        }
+        if (syn) { cw[syn] ^= 1; st->corrected++; }
+
+        for (k = 0; k < 4 && b * 4 + k < out->nbits; k++)
+            bitvec_set(out, b * 4 + k, cw[h74_data_pos[k]]);
+    }
+}
+
+/* maximum-likelihood: correlate against all 16 codewords */
+static void h74_decode_soft(const struct ecc_code *c, const float *llr,
+                            struct bitvec *out, struct ecc_stats *st)
+{
+    (void)c;
+    for (size_t b = 0; b * 4 < out->nbits; b++) {
+        const float *l = llr + b * 7;
+        double best = -1e300;
+        int    best_d = 0, best_cw[8] = { 0 }, k;
+
+        for (int d = 0; d < 16; d++) {
+            int    cw[8] = { 0 };
+            double m = 0.0;
+
+            for (k = 0; k < 4; k++)
+                cw[h74_data_pos[k]] = (d >> k) & 1;
+            cw[1] = cw[3] ^ cw[5] ^ cw[7];
+            cw[2] = cw[3] ^ cw[6] ^ cw[7];
+            cw[4] = cw[5] ^ cw[6] ^ cw[7];
+            for (k = 1; k <= 7; k++)
+                m += cw[k] ? l[k - 1] : -l[k - 1];
+
+            if (m > best) {
+                best   = m;
+                best_d = d;
+                memcpy(best_cw, cw, sizeof(cw));
+            }
+        }
+
+        for (k = 1; k <= 7; k++)
+            if ((l[k - 1] > 0.0f) != best_cw[k]) st->corrected++;
+        for (k = 0; k < 4 && b * 4 + k < out->nbits; k++)
+            bitvec_set(out, b * 4 + k, (best_d >> k) & 1);
+    }
+}
+
+/* ---- extended Hamming(72,64) SECDED ---------------------------------- */
+
+static int secded_data_pos[SECDED_DATA];
+
+static void secded_tables(void)
+{
+    if (secded_data_pos[0]) return;
+    int k = 0;
+    for (int p = 1; p < SECDED_POS && k < SECDED_DATA; p++)
+        if (p & (p - 1)) secded_data_pos[k++] = p;
+}
+
+/* Transmitted positions of a block carrying k data bits, in send order. */
+static int secded_block_pos(int k, int *pos)
+{
+    int last = secded_data_pos[k - 1], n = 0, d = 0;
+
+    pos[n++] = 0;
+    for (int p = 1; p <= last; p++) {
+        if (!(p & (p - 1)))                          pos[n++] = p;
+        else if (d < k && secded_data_pos[d] == p) { pos[n++] = p; d++; }
+    }
+    return n;
+}
+
+static size_t secded_len(const struct ecc_code *c, size_t nbits)
+{
+    int    pos[SECDED_POS];
+    size_t full = nbits / SECDED_DATA, tail = nbits % SECDED_DATA;
+    (void)c;
+
+    secded_tables();
+    return full * SECDED_POS + (tail ? (size_t)secded_block_pos((int)tail, pos) : 0);
+}
+
+static void secded_encode(const struct ecc_code *c, const struct bitvec *in,
+                          struct bitvec *out)
+{
+    size_t o = 0;
+    (void)c;
+
+    secded_tables();
+    for (size_t base = 0; base < in->nbits; base += SECDED_DATA) {
+        int k = in->nbits - base < SECDED_DATA ? (int)(in->nbits - base) : SECDED_DATA;
+        int cw[SECDED_POS] = { 0 }, pos[SECDED_POS], syn = 0, par = 0, n, i;
+
+        for (i = 0; i < k; i++) {
+            int p = secded_data_pos[i];
+            cw[p] = bitvec_get(in, base + i);
+            if (cw[p]) syn ^= p;
+        }
+        for (i = 1; i < SECDED_POS; i <<= 1)
+            cw[i] = (syn & i) ? 1 : 0;
+        for (i = 1; i < SECDED_POS; i++)
+            par ^= cw[i];
+        cw[0] = par;
+
+        n = secded_block_pos(k, pos);
+        for (i = 0; i < n; i++)
+            bitvec_set(out, o++, cw[pos[i]]);
+    }
+}
+
+/*
+ * Hard-decodes one block (cw[] indexed by position, sent[] marks transmitted
+ * positions).  Returns 0 if the block is valid or was corrected, -1 if an
+ * uncorrectable error was detected.
+ */
+static int secded_fix(int *cw, const int *sent, const int *pos, int n)
+{
+    int syn = 0, par = 0;
+
+    for (int i = 0; i < n; i++) {
+        par ^= cw[pos[i]];
+        if (cw[pos[i]]) syn ^= pos[i];
+    }
+    if (par) {
+        /* odd number of flips: assume one, at the syndrome position */
+        if (syn < SECDED_POS && sent[syn]) { cw[syn] ^= 1; return 0; }
+        return -1;
+    }
+    return syn ? -1 : 0;
+}
+
+static void secded_decode(const struct ecc_code *c, const struct bitvec *in,
+                          struct bitvec *out, struct ecc_stats *st)
+{
+    size_t o = 0;
+    (void)c;
+
+    secded_tables();
+    for (size_t base = 0; base < out->nbits; base += SECDED_DATA) {
+        int k = out->nbits - base < SECDED_DATA ? (int)(out->nbits - base) : SECDED_DATA;
+        int cw[SECDED_POS] = { 0 }, sent[SECDED_POS] = { 0 }, pos[SECDED_POS];
+        int hard[SECDED_POS], n, i;
+
+        n = secded_block_pos(k, pos);
+        for (i = 0; i < n; i++) {
+            cw[pos[i]]   = bitvec_get(in, o++);
+            sent[pos[i]] = 1;
+        }
+
+        memcpy(hard, cw, sizeof(cw));
+        if (secded_fix(cw, sent, pos, n) != 0) st->detected++;
+        else if (memcmp(hard, cw, sizeof(cw)) != 0) st->corrected++;
+
+        for (i = 0; i < k; i++)
+            bitvec_set(out, base + i, cw[secded_data_pos[i]]);
+    }
+}
+
+/* Chase-II: try every flip pattern of the CHASE_BITS least reliable bits */
+static void secded_decode_soft(const struct ecc_code *c, const float *llr,
+                               struct bitvec *out, struct ecc_stats *st)
+{
+    size_t o = 0;
+    (void)c;
+
+    secded_tables();
+    for (size_t base = 0; base < out->nbits; base += SECDED_DATA) {
+        int k = out->nbits - base < SECDED_DATA ? (int)(out->nbits - base) : SECDED_DATA;
+        int hard[SECDED_POS] = { 0 }, sent[SECDED_POS] = { 0 }, best_cw[SECDED_POS];
+        int pos[SECDED_POS], weak[CHASE_BITS], n, i, j;
+        const float *l = llr + o;
+        double best = -1e300;
+
+        n = secded_block_pos(k, pos);
+        for (i = 0; i < n; i++) {
+            hard[pos[i]] = l[i] > 0.0f;
+            sent[pos[i]] = 1;
+        }
+
+        /* indices into pos[] of the CHASE_BITS smallest |llr| */
+        for (j = 0; j < CHASE_BITS; j++) {
+            weak[j] = -1;
+            for (i = 0; i < n; i++) {
+                int used = 0;
+                for (int q = 0; q < j; q++) used |= weak[q] == i;
+                if (!used && (weak[j] < 0 || fabsf(l[i]) < fabsf(l[weak[j]])))
+                    weak[j] = i;
+            }
+        }
+
+        for (int pat = 0; pat < (1 << CHASE_BITS); pat++) {
+            int cw[SECDED_POS];
+            memcpy(cw, hard, sizeof(cw));
+            for (j = 0; j < CHASE_BITS; j++)
+                if (((pat >> j) & 1) && weak[j] >= 0) cw[pos[weak[j]]] ^= 1;
+            if (secded_fix(cw, sent, pos, n) != 0) continue;
+
+            double m = 0.0;
+            for (i = 0; i < n; i++)
+                m += cw[pos[i]] ? l[i] : -l[i];
+            if (m > best) {
+                best = m;
+                memcpy(best_cw, cw, sizeof(cw));
+            }
+        }
+
+        if (best == -1e300) {
+            memcpy(best_cw, hard, sizeof(best_cw));
+            st->detected++;
+        } else {
+            for (i = 0; i < n; i++)
+                if (best_cw[pos[i]] != hard[pos[i]]) st->corrected++;
+        }
+
+        for (i = 0; i < k; i++)
+            bitvec_set(out, base + i, best_cw[secded_data_pos[i]]);
+        o += n;
+    }
+}
+
+/* ---- rate-1/2 K=7 convolutional, Viterbi ----------------------------- */
+
+static size_t conv_len(const struct ecc_code *c, size_t nbits)
+{
+    (void)c;
+    return 2 * (nbits + CONV_K - 1);
+}
+
+static void conv_encode(const struct ecc_code *c, const struct bitvec *in,
+                        struct bitvec *out)
+{
+    struct conv_encoder e;
+    size_t o = 0;
+    (void)c;
+
+    conv_encoder_init(&e);
+    for (size_t i = 0; i < in->nbits + CONV_K - 1; i++) {
+        int pair[2];
+        conv_encode_bit(&e, i < in->nbits ? bitvec_get(in, i) : 0, pair);
+        bitvec_set(out, o++, pair[0]);
+        bitvec_set(out, o++, pair[1]);
+    }
+}
+
+struct conv_sink {
+    struct bitvec *out;
+    size_t         n;
+};
+
+static void conv_emit(void *arg, int bit)
+{
+    struct conv_sink *k = arg;
+    if (k->n < k->out->nbits) bitvec_set(k->out, k->n, bit);
+    k->n++;
+}
+
+/* coded bits whose hard decision disagrees with the re-encoded result */
+static long conv_count_flips(const struct bitvec *out, const float *llr,
+                             const struct bitvec *hard)
+{
+    struct conv_encoder e;
+    long   flips = 0;
+    size_t o = 0;
+
+    conv_encoder_init(&e);
+    for (size_t i = 0; i < out->nbits + CONV_K - 1; i++) {
+        int pair[2];
+        conv_encode_bit(&e, i < out->nbits ? bitvec_get(out, i) : 0, pair);
+        for (int j = 0; j < 2; j++, o++) {
+            int h = hard ? bitvec_get(hard, o) : llr[o] > 0.0f;
+            flips += h != pair[j];
+        }
+    }
+    return flips;
+}
+
+static void conv_decode_soft(const struct ecc_code *c, const float *llr,
+                             struct bitvec *out, struct ecc_stats *st)
+{
+    struct conv_decoder *d = aligned_alloc(32, sizeof(*d));
+    struct conv_sink     k = { out, 0 };
+    (void)c;
+
+    if (!d) { perror("conv: malloc"); return; }
+    conv_decoder_init(d, conv_emit, &k);
+    conv_decoder_push(d, llr, out->nbits + CONV_K - 1);
+    conv_decoder_finish(d);
+    free(d);
+    st->corrected += conv_count_flips(out, llr, NULL);
+}
+
+/* hard input is fed as +/-1 LLRs, a block at a time */
+static void conv_decode(const struct ecc_code *c, const struct bitvec *in,
+                        struct bitvec *out, struct ecc_stats *st)
+{
+    struct conv_decoder *d = aligned_alloc(32, sizeof(*d));
+    struct conv_sink     k = { out, 0 };
+    size_t steps = out->nbits + CONV_K - 1;
+    float  llr[2 * CONV_BLOCK];
+    (void)c;
+
+    if (!d) { perror("conv: malloc"); return; }
+    conv_decoder_init(d, conv_emit, &k);
+    for (size_t t = 0; t < steps; t += CONV_BLOCK) {
+        size_t n = steps - t < CONV_BLOCK ? steps - t : CONV_BLOCK;
+        for (size_t j = 0; j < 2 * n; j++)
+            llr[j] = bitvec_get(in, 2 * t + j) ? 1.0f : -1.0f;
+        conv_decoder_push(d, llr, n);
+    }
+    conv_decoder_finish(d);
+    free(d);
+    st->corrected += conv_count_flips(out, NULL, in);
+}
+
+/* ---- selection ------------------------------------------------------- */
+
+int ecc_code_select(struct ecc_code *c, const char *name)
+{
+    memset(c, 0, sizeof(*c));
+    c->name = name;
+
+    if (strncmp(name, "rep", 3) == 0) {
+        c->n = name[3] ? atoi(name + 3) : 3;
+        if (c->n < 1 || !(c->n & 1)) {
+            fprintf(stderr, "ecc: repetition factor must be odd: %s\n", name);
+            return -1;
+        }
+        c->encoded_len = rep_len;
+        c->encode      = rep_encode;
+        c->decode      = rep_decode;
+        c->decode_soft = rep_decode_soft;
+    } else if (strcmp(name, "hamming74") == 0) {
+        c->encoded_len = h74_len;
+        c->encode      = h74_encode;
+        c->decode      = h74_decode;
+        c->decode_soft = h74_decode_soft;
+    } else if (strcmp(name, "secded") == 0) {
+        c->encoded_len = secded_len;
+        c->encode      = secded_encode;
+        c->decode      = secded_decode;
+        c->decode_soft = secded_decode_soft;
+    } else if (strcmp(name, "conv") == 0) {
+        c->encoded_len = conv_len;
+        c->encode      = conv_encode;
+        c->decode      = conv_decode;
+        c->decode_soft = conv_decode_soft;
+    } else {
+        fprintf(stderr, "ecc: unknown code '%s' (repN, hamming74, secded, conv)\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+int ecc_encode(const struct ecc_code *c, const struct bitvec *in,
+               struct bitvec *out)
+{
+    if (bitvec_init(out, c->encoded_len(c, in->nbits)) != 0) return -1;
+    c->encode(c, in, out);
+    return 0;
+}
+
+int ecc_decode(const struct ecc_code *c, const struct bitvec *in,
+               size_t nbits, struct bitvec *out, struct ecc_stats *st)
+{
+    if (in->nbits < c->encoded_len(c, nbits)) {
+        fprintf(stderr, "ecc: %zu coded bits, %s needs %zu for %zu data bits\n",
+                in->nbits, c->name, c->encoded_len(c, nbits), nbits);
+        return -1;
+    }
+    if (bitvec_init(out, nbits) != 0) return -1;
+    memset(st, 0, sizeof(*st));
+    c->decode(c, in, out, st);
+    return 0;
+}
+
+int ecc_decode_soft(const struct ecc_code *c, const float *llr, size_t nllr,
+                    size_t nbits, struct bitvec *out, struct ecc_stats *st)
+{
+    if (nllr < c->encoded_len(c, nbits)) {
+        fprintf(stderr, "ecc: %zu LLRs, %s needs %zu for %zu data bits\n",
+                nllr, c->name, c->encoded_len(c, nbits), nbits);
+        return -1;
+    }
+    if (bitvec_init(out, nbits) != 0) return -1;
+    memset(st, 0, sizeof(*st));
+    c->decode_soft(c, llr, out, st);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef ECC_H
+#define ECC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bit-packed error-correcting codes for the covert channel.
+ *
+ * Payloads are carried in a bitvec (bit i lives in word i/64, bit i%64).
+ * Every code implements the same encode/decode pair and is picked by name
+ * with ecc_code_select(), which is what the --code flag of the ECC
+ * binaries maps to:
+ *
+ *   repN       each bit sent N times, majority vote (N odd, default rep3)
+ *   hamming74  Hamming(7,4), corrects one error per 7-bit block
+ *   secded     extended Hamming(72,64): corrects one and detects two errors
+ *              per block; the last block is shortened to its data length
+ *   conv       rate-1/2 K=7 convolutional code, streaming Viterbi (conv.h)
+ *
+ * Every code can also decode soft input: one LLR per coded bit,
+ * log P(1)/P(0), as produced by level_tracker_llr().  repN sums the LLRs,
+ * hamming74 picks the maximum-correlation codeword, and secded runs a
+ * Chase search over its least reliable bits, and conv runs soft Viterbi.
+ */
+struct bitvec {
+    uint64_t *w;
+    size_t    nbits;
+};
+
+int    bitvec_init(struct bitvec *bv, size_t nbits);
+void   bitvec_free(struct bitvec *bv);
+int    bitvec_from_string(struct bitvec *bv, const char *bits);
+void   bitvec_to_string(const struct bitvec *bv, char *out);   /* nbits + 1 bytes */
+
+static inline int bitvec_get(const struct bitvec *bv, size_t i)
+{
+    return (int)((bv->w[i >> 6] >> (i & 63)) & 1);
+}
+
+static inline void bitvec_set(struct bitvec *bv, size_t i, int v)
+{
+    uint64_t m = (uint64_t)1 << (i & 63);
+    if (v) bv->w[i >> 6] |=  m;
+    else   bv->w[i >> 6] &= ~m;
+}
+
+struct ecc_stats {
+    long corrected;     /* bit errors fixed */
+    long detected;      /* blocks with errors that could not be fixed */
+};
+
+struct ecc_code {
+    const char *name;
+    int         n;      /* repetition factor for repN */
+    size_t (*encoded_len)(const struct ecc_code *c, size_t nbits);
+    void   (*encode)(const struct ecc_code *c, const struct bitvec *in,
+                     struct bitvec *out);
+    void   (*decode)(const struct ecc_code *c, const struct bitvec *in,
+                     struct bitvec *out, struct ecc_stats *st);
+    void   (*decode_soft)(const struct ecc_code *c, const float *llr,
+                          struct bitvec *out, struct ecc_stats *st);
+};
+
+/* Returns 0 and fills *c for a known code name, -1 otherwise. */
+int    ecc_code_select(struct ecc_code *c, const char *name);
+
+/*
+ * Convenience wrappers: out is (re)initialized to the right length.
+ * ecc_decode() produces `nbits` data bits.
+ */
+int    ecc_encode(const struct ecc_code *c, const struct bitvec *in,
+                  struct bitvec *out);
+int    ecc_decode(const struct ecc_code *c, const struct bitvec *in,
+                  size_t nbits, struct bitvec *out, struct ecc_stats *st);
+int    ecc_decode_soft(const struct ecc_code *c, const float *llr, size_t nllr,
+                       size_t nbits, struct bitvec *out, struct ecc_stats *st);
+
+#endif
@@ -1,177 +1,161 @@
-
-
+/*
+ * Receiver for ecc_transmitter: decodes the received bits (ecc.h), from
+ * hard decisions or soft LLRs.
+ *
+ *  gcc -fopenmp -O3 ecc_receiver.c stream_sampler.c robust.c sync.c level_tracker.c ecc.c \
+ *      conv.c topology.c hugemem.c kernels.c timing.c -o ecc_receiver -lm
+ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
-#include <signal.h>
-#include <sys/wait.h>
-#include <fcntl.h>
-#include <sys/time.h>
 #include <math.h>
+#include "timing.h"
+#include "stream_sampler.h"
+#include "sync.h"
+#include "topology.h"
+#include "level_tracker.h"
+#include "ecc.h"
+#include "robust.h"
 
-#define SYNC_FILE    "/tmp/covert_start"
 #define BIT_DURATION 0.001
 #define DEFAULT_BITS 16
+#define SAMPLER_ELEMS 500000
+#define MAX_SAMPLES  4096
+#define SYNC_TIMEOUT 60.0
+#define DEFAULT_CODE "rep3"
 
-double mysecond()
-{
-        struct timeval tp;
-        struct timezone tzp;
-        int i;
-
-        i = gettimeofday(&tp,&tzp);
-        return ( (double) tp.tv_sec + (double) tp.tv_usec * 1.e-6 );
-}
-
-static void sleep_until(double target)
-{
-    double remaining = target - mysecond();
-    if (remaining <= 0.0) return;
-    struct timespec ts;
-    ts.tv_sec  = (time_t)remaining;
-    ts.tv_nsec = (long)((remaining - ts.tv_sec) * 1e9);
-    nanosleep(&ts, NULL);
-}
-
-static double run_simple_stream(double until)
-{
-    double sum   = 0.0;
-    int    count = 0;
-
-    while (mysecond() < until) {
-        int pipefd[2];
-        if (pipe(pipefd) == -1) { perror("pipe"); break; }
-
-        pid_t pid = fork();
-        if (pid == 0) {
-            close(pipefd[0]);
-            dup2(pipefd[1], STDOUT_FILENO);
-            dup2(pipefd[1], STDERR_FILENO);
-            close(pipefd[1]);
-            execl("./simple_stream", "simple_stream", NULL);
-            perror("execl");
-            _exit(1);
-        } else if (pid < 0) {
-            perror("fork");
-            close(pipefd[0]); close(pipefd[1]);
-            break;
-        }
-
-        close(pipefd[1]);
-
-        while (1) {
-            if (mysecond() >= until) {
-                kill(pid, SIGKILL);
-                waitpid(pid, NULL, 0);
-                close(pipefd[0]);
-                goto done;          
-            }
-            int   status;
-            pid_t r = waitpid(pid, &status, WNOHANG);
-            if (r == pid) break;    
-            usleep(1000);
-        }
-
-        char    accum[65536];
-        int     accum_len = 0;
-        char    tmp[4096];
-        ssize_t n;
-        while ((n = read(pipefd[0], tmp, sizeof(tmp) - 1)) > 0) {
-            if (accum_len + n < (int)sizeof(accum) - 1) {
-                memcpy(accum + accum_len, tmp, n);
-                accum_len += n;
-            }
-        }
-        close(pipefd[0]);
-
-        accum[accum_len] = '\0';
-        char *line = strtok(accum, "\n");
-        while (line) {
-            if (strncmp(line, "Copy:", 5) == 0) {
-                char *p = line + 5;
-                while (*p == ' ' || *p == '\t') p++;
-                double bw = atof(p);
-                if (bw > 0.0) { sum += bw; count++; }
-            }
-            line = strtok(NULL, "\n");
-        }
-        usleep(1000);
-    }
-
-done:
-    if (count == 0) return 0.0;
-    printf("receiver: averaged %d sample(s)\n", count);
-    return sum / count;
-}
+static struct stream_sampler sampler;
+static double                samples[MAX_SAMPLES];
 
 int main(int argc, char *argv[])
 {
-    int    num_bits  = DEFAULT_BITS;
-    double threshold = 0.0;
+    timing_init();
+
+    int         num_bits  = DEFAULT_BITS;
+    double      threshold = 0.0;
+    long        elems     = SAMPLER_ELEMS;
+    double      period    = 0.0;
+    double      timeout   = SYNC_TIMEOUT;
+    double      alpha     = LEVEL_ALPHA;
+    const char *code_name = DEFAULT_CODE;
+    int         soft      = 0;
+    const char *cpus      = NULL;
+    const char *kernel    = NULL;
+    int         node      = -1;
 
     for (int i = 1; i < argc; i++) {
         if      (strcmp(argv[i], "--bits")      == 0 && i+1 < argc) num_bits  = atoi(argv[++i]);
         else if (strcmp(argv[i], "--threshold") == 0 && i+1 < argc) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--elems")     == 0 && i+1 < argc) elems     = atol(argv[++i]);
+        else if (strcmp(argv[i], "--sample-period") == 0 && i+1 < argc) period = atof(argv[++i]);
+        else if (strcmp(argv[i], "--cpus")      == 0 && i+1 < argc) cpus      = argv[++i];
+        else if (strcmp(argv[i], "--node")      == 0 && i+1 < argc) node      = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--kernel")    == 0 && i+1 < argc) kernel    = argv[++i];
+        else if (strcmp(argv[i], "--sync-timeout") == 0 && i+1 < argc) timeout = atof(argv[++i]);
+        else if (strcmp(argv[i], "--alpha")     == 0 && i+1 < argc) alpha     = atof(argv[++i]);
+        else if (strcmp(argv[i], "--code")      == 0 && i+1 < argc) code_name = argv[++i];
+        else if (strcmp(argv[i], "--soft")      == 0)               soft      = 1;
+    }
+
+    struct ecc_code code;
+    struct bitvec   rx;
+    if (ecc_code_select(&code, code_name) != 0) return 1;
+    if (bitvec_init(&rx, code.encoded_len(&code, num_bits)) != 0) return 1;
+    float *llr = calloc(rx.nbits ? rx.nbits : 1, sizeof(float));
+    if (!llr) { fprintf(stderr, "malloc failed\n"); return 1; }
+    printf("receiver: expecting %zu coded bits for %d data bits (%s)\n",
+           rx.nbits, num_bits, code.name);
+
+    struct placement         pl;
+    const struct mem_kernel *k = kernel_select(kernel);
+    if (!k || placement_init(&pl, cpus, node) != 0) return 1;
+    placement_print(&pl, "receiver", stdout);
+    if (period > 0.0) {
+        if (stream_sampler_init_period(&sampler, period, &pl, k) != 0) return 1;
+    } else {
+        if (stream_sampler_init(&sampler, (size_t)elems, &pl) != 0) return 1;
+        stream_sampler_set_kernel(&sampler, k);
     }
+    printf("receiver: sampling with the %s kernel, %zu elements, %.3f ms per pass\n",
+           k->name, sampler.n, 1e3 * sampler.last_pass);
+    hugemem_print(&sampler.ma, "receiver: sampler", stdout);
 
-    printf("receiver: calibrating baseline (transmitter not yet active)...\n");
+    printf("receiver: waiting for preamble...\n");
     fflush(stdout);
-    double baseline = run_simple_stream(mysecond()+2);
 
+    struct sync_result sync;
+    if (sync_wait(&sampler, BIT_DURATION, timeout, &sync) != 0) {
+        fprintf(stderr, "receiver: no preamble within %.0fs\n", timeout);
+        return 1;
+    }
+    printf("receiver: preamble at %.6f (corr %.2f, clock offset %+.1f us)\n",
+           sync.start, sync.corr, sync.offset * 1e6);
+
+    struct level_tracker lt;
+    double baseline = sync.level0;
+    level_tracker_init(&lt, sync.level0, sync.level1, alpha);
     if (threshold <= 0.0) {
-        threshold = baseline * 0.9;
-        printf("receiver: baseline = %.0f MB/s  =>  threshold = %.0f MB/s\n\n",
-               baseline, threshold);
+        printf("receiver: idle = %.0f MB/s, hammered = %.0f MB/s  =>  threshold = %.0f MB/s (tracking)\n\n",
+               sync.level0, sync.level1, lt.threshold);
     } else {
+        level_tracker_fix(&lt, threshold);
         printf("receiver: baseline = %.0f MB/s, using fixed threshold = %.0f MB/s\n\n",
                baseline, threshold);
     }
     fflush(stdout);
 
-    double start_time = floor(mysecond() / 60.0) * 60.0 + 60.0;;
-    
+    double start_time = sync.start + SYNC_CHIPS * BIT_DURATION;
 
     char *received = (char *)malloc(num_bits + 1);
     if (!received) { fprintf(stderr, "malloc failed\n"); return 1; }
 
-    for (int i = 0; i < num_bits; i++) { //implement something that checks current time and if it's current time is ahead of where it should be just mark that bit as x
-        char votes[3];
-        for(int j =0 ; j<3;j++){
-            double window_start = start_time + i * BIT_DURATION+j*BIT_DURATION;
-            double window_end = window_start + BIT_DURATION*(j+1);
-
-            sleep_until(window_start+BIT_DURATION*0.01);
-            if(mysecond() > window_end){
-                printf("receiver: [bit %d] missed window setting to x...\n", i);
-                fflush(stdout);
-                char bit = '0';
-                votes[j] = bit;
-            }else{
-                printf("receiver: [bit %d] window open, running simple_stream at time = %.3f...\n", i, mysecond());
-                fflush(stdout);
-
-                double bw  = run_simple_stream(window_end-BIT_DURATION*0.05);
-                char   bit = (bw < threshold) ? '1' : '0';
-                votes[j] = bit;
-
-            }
+    for (size_t i = 0; i < rx.nbits; i++) {
+        double window_start = start_time + i * BIT_DURATION;
+        double window_end   = window_start + BIT_DURATION;
+
+        sleep_until(window_start+BIT_DURATION*0.01);
+        if(mysecond() > window_end){
+            printf("receiver: [coded bit %zu] missed window setting to 0...\n", i);
+            fflush(stdout);
+        }else{
+            struct robust_window w;
+            double bw  = robust_stream_window(&sampler, window_end-BIT_DURATION*0.05,
+                                              samples, MAX_SAMPLES, &w);
+            robust_print(&w, "receiver", stdout);
+            llr[i]     = (float)level_tracker_llr(&lt, bw);
+            char   bit = level_tracker_decide(&lt, bw);
+            bitvec_set(&rx, i, bit == '1');
+
+            printf("receiver: coded bit %3zu | Copy rate = %8.0f MB/s | LLR = %+6.2f | decoded = '%c'\n",
+                   i, bw, llr[i], bit);
+            fflush(stdout);
         }
-        int ones = 0;
-        for (int j = 0; j < 3; j++)
-            if (votes[j] == '1') ones++;
-        if (ones > 3 / 2) received[i] = '1';
-        if (ones < 3 / 2) received[i] = '0';
-        printf("receiver: bit %2d| decoded = '%c' \n\n", i, received[i]);
-        fflush(stdout);
     }
+
+    struct bitvec    data;
+    struct ecc_stats st;
+    int rc = soft ? ecc_decode_soft(&code, llr, rx.nbits, num_bits, &data, &st)
+                  : ecc_decode(&code, &rx, num_bits, &data, &st);
+    if (rc != 0) return 1;
+    bitvec_to_string(&data, received);
+    printf("receiver: %s %s decode corrected %ld bit(s), %ld uncorrectable block(s)\n",
+           code.name, soft ? "soft" : "hard", st.corrected, st.detected);
     received[num_bits] = '\0';
 
+    if (!lt.fixed)
+        printf("receiver: tracked levels idle = %.0f MB/s, hammered = %.0f MB/s, threshold = %.0f MB/s\n",
+               lt.level0, lt.level1, lt.threshold);
+
     printf("==========================================\n");
     printf("receiver: received bits -> \"%s\"\n", received);
     printf("==========================================\n");
 
     free(received);
+    bitvec_free(&data);
+    bitvec_free(&rx);
+    free(llr);
+    stream_sampler_free(&sampler);
     return 0;
 }
\ No newline at end of file
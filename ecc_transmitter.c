@@ -1,123 +1,100 @@
-
+/*
+ * Memory-bandwidth covert channel sender with forward error correction:
+ * the message is encoded (ecc.h) before it is sent.
+ *
+ *  gcc -fopenmp -O3 -pthread ecc_transmitter.c contention_pool.c sync.c stream_sampler.c ecc.c \
+ *      conv.c topology.c hugemem.c kernels.c timing.c -o ecc_transmitter -lm
+ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <signal.h>
-#include <sys/wait.h>
-#include <sys/time.h>
 #include <math.h>
+#include "timing.h"
+#include "contention_pool.h"
+#include "sync.h"
+#include "topology.h"
+#include "ecc.h"
 
-#define SYNC_FILE    "/tmp/covert_start"
+#define POOL_ELEMS   2000000
 #define BIT_DURATION 0.001  
+#define DEFAULT_CODE "rep3"
 
-double mysecond()
-{
-        struct timeval tp;
-        struct timezone tzp;
-        int i;
-
-        i = gettimeofday(&tp,&tzp);
-        return ( (double) tp.tv_sec + (double) tp.tv_usec * 1.e-6 );
-}
-
-static void sleep_until(double target)
-{
-    double remaining = target - mysecond();
-    if (remaining <= 0.0) return;
-    struct timespec ts;
-    ts.tv_sec  = (time_t)remaining;
-    ts.tv_nsec = (long)((remaining - ts.tv_sec) * 1e9);
-    nanosleep(&ts, NULL);
-}
-
-static void hammer_memory(double until) {
-    while (mysecond() < until) {
-
-        pid_t pid = fork();
-
-        if (pid == 0) {
-            int devnull = open("/dev/null", O_WRONLY);
-            dup2(devnull, STDOUT_FILENO);
-            dup2(devnull, STDERR_FILENO);
-            close(devnull);
-            execl("./simple_stream", "simple_stream", NULL);
-            perror("execl failed");
-            _exit(1);
-        }
-
-        else if (pid > 0) {
-            int status;
-
-            while (1) {
-                if (mysecond() >= until) {
-                    kill(pid, SIGKILL);
-                    waitpid(pid, NULL, 0);
-                    return; 
-                }
-                pid_t result = waitpid(pid, &status, WNOHANG);
-                if (result == pid) {
-                    break; 
-                }
-            }
-        }
-    }
-}
-
-static char *repetition_encode(const char *bits)
-{
-    int n = strlen(bits);
-    char *encoded = malloc(n * 3 + 1);
-    if (!encoded) { perror("malloc"); exit(1); }
-    for (int i = 0; i < n; i++)
-        for (int r = 0; r < 3; r++)
-            encoded[i * 3 + r] = bits[i];
-    encoded[n * 3] = '\0';
-    return encoded;
-}
+static struct contention_pool pool;
 
 int main(int argc, char *argv[])
 {
-    const char *bits = NULL;
-    for (int i = 1; i < argc; i++)
-        if (strcmp(argv[i], "--binary") == 0 && i+1 < argc)
-            bits = argv[++i];
+    timing_init();
+
+    const char *bits     = NULL;
+    int         nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long        elems    = POOL_ELEMS;
+    const char *cpus     = NULL;
+    const char *kernel   = NULL;
+    int         node     = -1;
+    const char *code_name = DEFAULT_CODE;
+    for (int i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--binary")  == 0 && i+1 < argc) bits     = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) nthreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--elems")   == 0 && i+1 < argc) elems    = atol(argv[++i]);
+        else if (strcmp(argv[i], "--cpus")    == 0 && i+1 < argc) cpus     = argv[++i];
+        else if (strcmp(argv[i], "--node")    == 0 && i+1 < argc) node     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--kernel")  == 0 && i+1 < argc) kernel   = argv[++i];
+        else if (strcmp(argv[i], "--code")    == 0 && i+1 < argc) code_name = argv[++i];
+    }
 
     if (!bits) {
-        fprintf(stderr, "Usage: %s --binary \"01010101...\"\n", argv[0]);
+        fprintf(stderr, "Usage: %s --binary \"01010101...\" [--code repN|hamming74|secded|conv]\n", argv[0]);
         return 1;
     }
-    char *tx_bits;
-    tx_bits = repetition_encode(bits);
-    double start_time = floor(mysecond() / 60.0) * 60.0 + 60.0;  //get rid of this and sync up at the nxt minuite or something
 
-
-    printf("transmitter: bit 0 starts in ~2s\n");
-
-    for (size_t i = 0; i < strlen(tx_bits); i++) {
-        char bit = tx_bits[i];
+    struct ecc_code code;
+    struct bitvec   data, tx;
+    if (ecc_code_select(&code, code_name) != 0) return 1;
+    if (bitvec_from_string(&data, bits) != 0 || ecc_encode(&code, &data, &tx) != 0) return 1;
+    printf("transmitter: %zu data bits -> %zu coded bits (%s)\n",
+           data.nbits, tx.nbits, code.name);
+
+    struct placement pl;
+    if (placement_init(&pl, cpus, node) != 0) return 1;
+    if (!pl.ncpus) placement_online(&pl);
+    placement_print(&pl, "transmitter", stdout);
+
+    const struct mem_kernel *k = kernel_select(kernel);
+    if (!k) return 1;
+    printf("transmitter: %d worker(s) running the %s kernel\n", nthreads, k->name);
+
+    if (contention_pool_start(&pool, nthreads, (size_t)elems, &pl) != 0) return 1;
+    contention_pool_set_kernel(&pool, k);
+    double preamble_start = sync_tx_start(BIT_DURATION);
+    double start_time     = preamble_start + SYNC_CHIPS * BIT_DURATION;
+
+    printf("transmitter: preamble starts in %.3fs, bit 0 at %.3f\n",
+           preamble_start - mysecond(), start_time);
+    fflush(stdout);
+    sync_send_preamble(preamble_start, BIT_DURATION, contention_pool_chip, NULL, &pool);
+
+    for (size_t i = 0; i < tx.nbits; i++) {
+        char bit = bitvec_get(&tx, i) ? '1' : '0';
         double bit_start = start_time + i * BIT_DURATION;
         double bit_end = start_time + (i + 1) * BIT_DURATION;
-        
-        if(i==0){
-            sleep_until(bit_start-1); 
-        }else{
-            sleep_until(bit_start); 
-        }
+
+        sleep_until(bit_start);
 
         printf("transmitter: bit %zu = '%c' -> %s starting at time = %.3f\n", i, bit, bit == '1' ? "hammered" : "slept", mysecond());
         fflush(stdout);
 
         if (bit == '1')
-            hammer_memory(bit_end); 
+            contention_pool_chip(&pool, bit_end); 
         else
             sleep_until(bit_end);
 
     }
 
-    remove(SYNC_FILE);
+    contention_pool_stop(&pool);
+    bitvec_free(&data);
+    bitvec_free(&tx);
     printf("transmitter: done.\n");
     return 0;
 }
\ No newline at end of file
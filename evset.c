@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "evset.h"
+#include "cacheutils.h"
+#include "topology.h"
+
+#define EVSET_FILE_VERSION 1
+
+int evset_pool_init(struct evset_pool *p, size_t bytes, size_t stride, int ways, int node)
+{
+    struct cache_calib cal;
+
+    memset(p, 0, sizeof(*p));
+    if (!stride) stride = EVSET_STRIDE;
+    if (ways <= 0) ways = topology_llc_ways();
+    if (ways <= 0 || ways > EVSET_MAX_WAYS) {
+        fprintf(stderr, "evset: LLC associativity %d unknown or above %d, give --ways\n",
+                ways, EVSET_MAX_WAYS);
+        return -1;
+    }
+    if (!bytes) bytes = EVSET_POOL_LLCS * topology_llc_bytes();
+    if (!bytes) {
+        fprintf(stderr, "evset: LLC size unknown, give a pool size\n");
+        return -1;
+    }
+    bytes = (bytes + stride - 1) / stride * stride;
+
+    if (cacheutils_selftest(&cal, CACHE_SELFTEST_ROUNDS) != 0) {
+        fprintf(stderr, "evset: cached and flushed loads do not separate, no threshold\n");
+        return -1;
+    }
+    if (hugemem_alloc(&p->mem, bytes, HUGEMEM_HUGETLB, node) != 0) return -1;
+
+    p->base      = p->mem.p;
+    p->bytes     = bytes;
+    p->stride    = stride;
+    p->ncand     = bytes / stride;
+    p->ways      = ways;
+    p->threshold = cal.threshold;
+    return 0;
+}
+
+void evset_pool_free(struct evset_pool *p)
+{
+    hugemem_free(&p->mem);
+    p->base = NULL;
+}
+
+int evset_evicts(const struct evset_pool *p, size_t target, const size_t *lines, int n)
+{
+    const uint8_t *t = p->base + target;
+    int            misses = 0;
+
+    for (int k = 0; k < EVSET_TESTS; k++) {
+        maccess(t);
+        mfence();
+        /* alternate directions so recently-used lines are not the ones kept */
+        for (int r = 0; r < EVSET_TRAVERSE; r++) {
+            if (r & 1) for (int i = n - 1; i >= 0; i--) maccess(p->base + lines[i]);
+            else       for (int i = 0; i < n; i++)      maccess(p->base + lines[i]);
+        }
+        /* another line of the target's page reloads its TLB entry, so a
+           page walk is not mistaken for an LLC miss */
+        maccess((const uint8_t *)((uintptr_t)t ^ 0x800));
+        misses += probe(t) >= p->threshold;
+    }
+    return 2 * misses > EVSET_TESTS;
+}
+
+/* Two out of three eviction tests, for the final check of a set. */
+static int evset_valid(const struct evset_pool *p, const struct evset *e)
+{
+    int ok = 0;
+    for (int i = 0; i < 3; i++) ok += evset_evicts(p, e->target, e->line, e->n);
+    return ok >= 2;
+}
+
+/*
+ * Reduces the candidates s[0..n) (reordered and overwritten) to a minimal
+ * eviction set for target.
+ */
+static int reduce(const struct evset_pool *p, size_t target, size_t *s, int n, struct evset *e)
+{
+    int     m = 2 * p->ways, groups = p->ways + 1, empty = 0;
+    size_t *rest;
+
+    /* the shortest doubling prefix that evicts keeps the first rounds cheap */
+    while (m < n && !evset_evicts(p, target, s, m)) m *= 2;
+    if (m >= n) {
+        m = n;
+        if (!evset_evicts(p, target, s, n)) return -1;
+    }
+    n = m;
+
+    if (!(rest = malloc((size_t)n * sizeof(*rest)))) {
+        perror("evset: malloc");
+        return -1;
+    }
+    /*
+     * ways + 1 groups always leave a removable one while the set is larger
+     * than a minimal set of `ways` lines.  On non-inclusive LLCs the minimal
+     * set can be larger (L2 and snoop-filter conflicts count too), so a
+     * round that removes nothing splits finer before it counts as a miss.
+     */
+    while (n > p->ways && empty <= EVSET_RETRIES) {
+        int found = 0;
+
+        if (groups > n) groups = n;
+        for (int g = 0; g < groups && !found; g++) {
+            int lo = (int)((long)n * g / groups), hi = (int)((long)n * (g + 1) / groups), r = 0;
+
+            for (int i = 0; i < n; i++)
+                if (i < lo || i >= hi) rest[r++] = s[i];
+            if (evset_evicts(p, target, rest, r)) {
+                memcpy(s, rest, (size_t)r * sizeof(*s));
+                n     = r;
+                found = 1;
+            }
+        }
+        if (!found && groups < n) groups *= 2;
+        else                      empty += !found;
+    }
+    free(rest);
+    if (n > EVSET_MAX_WAYS) return -1;
+
+    e->target = target;
+    e->n      = n;
+    memcpy(e->line, s, (size_t)n * sizeof(*s));
+    return evset_valid(p, e) ? 0 : -1;
+}
+
+int evset_build(struct evset_pool *p, size_t target, struct evset *e)
+{
+    size_t  off = target % p->stride;
+    size_t *s   = malloc(p->ncand * sizeof(*s));
+    int     rc  = -1;
+
+    if (!s) { perror("evset: malloc"); return -1; }
+
+    /* a false positive early on sends the reduction nowhere: start elsewhere and retry */
+    for (int attempt = 0; attempt < 3 && rc != 0; attempt++) {
+        size_t first = attempt * p->ncand / 3;
+        int    n     = 0;
+
+        for (size_t i = 0; i < p->ncand; i++) {
+            size_t o = ((first + i) % p->ncand) * p->stride + off;
+            if (o != target) s[n++] = o;
+        }
+        rc = reduce(p, target, s, n, e);
+    }
+    free(s);
+    return rc;
+}
+
+int evset_build_all(struct evset_pool *p, size_t offset, struct evset *sets, int have, int max)
+{
+    char   *used = calloc(p->ncand, 1);
+    size_t *s    = malloc(p->ncand * sizeof(*s));
+    int     found = have, failures = 0;
+
+    if (!used || !s) {
+        perror("evset: malloc");
+        free(used);
+        free(s);
+        return have;
+    }
+    offset %= p->stride;
+    for (int j = 0; j < have; j++) {
+        if (sets[j].target % p->stride != offset) continue;
+        used[sets[j].target / p->stride] = 1;
+        for (int i = 0; i < sets[j].n; i++) used[sets[j].line[i] / p->stride] = 1;
+    }
+
+    for (size_t c = 0; c < p->ncand && found < max && failures <= EVSET_RETRIES; c++) {
+        size_t t = c * p->stride + offset;
+        int    known = 0, n = 0;
+
+        if (used[c]) continue;
+        for (int j = 0; j < found && !known; j++)
+            known = sets[j].target % p->stride == offset &&
+                    evset_evicts(p, t, sets[j].line, sets[j].n);
+        used[c] = 1;
+        if (known) continue;
+
+        for (size_t i = 0; i < p->ncand; i++)
+            if (!used[i]) s[n++] = i * p->stride + offset;
+        if (reduce(p, t, s, n, &sets[found]) != 0) {
+            failures++;
+            continue;
+        }
+        for (int i = 0; i < sets[found].n; i++)
+            used[sets[found].line[i] / p->stride] = 1;
+        found++;
+    }
+    free(s);
+    free(used);
+    return found;
+}
+
+int evset_build_every(struct evset_pool *p, struct evset *sets, int have, int per_offset, int max)
+{
+    int found = have;
+
+    for (size_t off = 0; off < p->stride && found < max; off += EVSET_LINE) {
+        int at = 0, want;
+
+        for (int j = 0; j < found; j++) at += sets[j].target % p->stride == off;
+        if (at >= per_offset) continue;
+        want  = found + per_offset - at < max ? found + per_offset - at : max;
+        found = evset_build_all(p, off, sets, found, want);
+    }
+    return found;
+}
+
+void evset_cpu_model(char *buf, size_t len)
+{
+    unsigned r[12];
+    char     brand[49];
+    char    *b = brand;
+
+    memset(r, 0, sizeof(r));
+    if (!__get_cpuid(0x80000002, &r[0], &r[1], &r[2],  &r[3]) ||
+        !__get_cpuid(0x80000003, &r[4], &r[5], &r[6],  &r[7]) ||
+        !__get_cpuid(0x80000004, &r[8], &r[9], &r[10], &r[11])) {
+        snprintf(buf, len, "unknown");
+        return;
+    }
+    memcpy(brand, r, 48);
+    brand[48] = 0;
+    while (*b == ' ') b++;
+    for (char *e = b + strlen(b); e > b && e[-1] == ' '; ) *--e = 0;
+    snprintf(buf, len, "%s", b);
+}
+
+void evset_cache_name(char *buf, size_t len)
+{
+    char model[64];
+
+    evset_cpu_model(model, sizeof(model));
+    for (char *c = model; *c; c++)
+        if (!isalnum((unsigned char)*c) && *c != '-') *c = '_';
+    snprintf(buf, len, "evsets-%s.txt", model);
+}
+
+int evset_save(const char *path, const struct evset_pool *p, const struct evset *sets, int n)
+{
+    char  model[64];
+    FILE *f = fopen(path, "w");
+
+    if (!f) { perror(path); return -1; }
+    evset_cpu_model(model, sizeof(model));
+    fprintf(f, "evset %d\nmodel %s\n", EVSET_FILE_VERSION, model);
+    fprintf(f, "ways %d stride %zu pool %zu kind %s\n", p->ways, p->stride, p->bytes,
+            hugemem_kind_name(p->mem.kind));
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "set %zx %d", sets[i].target, sets[i].n);
+        for (int j = 0; j < sets[i].n; j++) fprintf(f, " %zx", sets[i].line[j]);
+        fprintf(f, "\n");
+    }
+    if (fclose(f) != 0) { perror(path); return -1; }
+    return 0;
+}
+
+int evset_load(const char *path, const struct evset_pool *p, struct evset *sets, int max)
+{
+    char   line[4096], model[128], params[128], want[64], kind[16];
+    int    version, ways, n = 0, stale = 0;
+    size_t stride, bytes;
+    FILE  *f = fopen(path, "r");
+
+    if (!f) return 0;
+    evset_cpu_model(want, sizeof(want));
+    if (!fgets(line, sizeof(line), f) || sscanf(line, "evset %d", &version) != 1 ||
+        version != EVSET_FILE_VERSION ||
+        !fgets(model, sizeof(model), f) || strncmp(model, "model ", 6) != 0 ||
+        !fgets(params, sizeof(params), f) ||
+        sscanf(params, "ways %d stride %zu pool %zu kind %15s", &ways, &stride, &bytes, kind) != 4) {
+        fprintf(stderr, "evset: %s: not an eviction set cache, ignored\n", path);
+        fclose(f);
+        return 0;
+    }
+    model[strcspn(model, "\n")] = 0;
+    if (strcmp(model + 6, want) != 0 || ways != p->ways || stride != p->stride ||
+        bytes != p->bytes || strcmp(kind, hugemem_kind_name(p->mem.kind)) != 0) {
+        fprintf(stderr, "evset: %s: made for another CPU or pool, ignored\n", path);
+        fclose(f);
+        return 0;
+    }
+
+    while (n < max && fgets(line, sizeof(line), f)) {
+        struct evset *e = &sets[n];
+        char         *s = line, *end;
+        int           ok = 1;
+
+        if (strncmp(s, "set ", 4) != 0) continue;
+        e->target = strtoull(s + 4, &end, 16);
+        e->n      = (int)strtol(end, &s, 10);
+        if (s == end || e->n < 1 || e->n > EVSET_MAX_WAYS || e->target >= p->bytes) continue;
+        for (int j = 0; j < e->n && ok; j++) {
+            e->line[j] = strtoull(s, &end, 16);
+            ok = end != s && e->line[j] < p->bytes;
+            s  = end;
+        }
+        if (!ok) continue;
+        if (evset_valid(p, e)) n++;
+        else                   stale++;
+    }
+    fclose(f);
+    if (stale)
+        fprintf(stderr, "evset: %s: %d set(s) no longer evict their target, dropped\n", path, stale);
+    return n;
+}
+
+int evset_cached(struct evset_pool *p, const char *path, size_t target, struct evset *e)
+{
+    char          name[128];
+    struct evset *sets = malloc(EVSET_CACHE_MAX * sizeof(*sets));
+    int           n, rc = 0;
+
+    if (!sets) { perror("evset: malloc"); return -1; }
+    if (!path) {
+        evset_cache_name(name, sizeof(name));
+        path = name;
+    }
+
+    n = evset_load(path, p, sets, EVSET_CACHE_MAX);
+    for (int i = 0; i < n; i++) {
+        if (sets[i].target != target) continue;
+        *e = sets[i];
+        free(sets);
+        return 0;
+    }
+    if (evset_build(p, target, e) != 0) rc = -1;
+    else {
+        if (n < EVSET_CACHE_MAX) sets[n++] = *e;
+        evset_save(path, p, sets, n);
+    }
+    free(sets);
+    return rc;
+}
+
+void evset_print(const struct evset_pool *p, const struct evset *e, const char *who, FILE *f)
+{
+    fprintf(f, "%s: eviction set for pool+0x%zx, %d/%d lines:", who, e->target, e->n, p->ways);
+    for (int i = 0; i < e->n; i++) fprintf(f, " +0x%zx", e->line[i]);
+    fprintf(f, "\n");
+}
@@ -0,0 +1,116 @@
+#ifndef EVSET_H
+#define EVSET_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hugemem.h"
+
+/*
+ * Eviction sets for the last-level cache, found by timing instead of
+ * guessed from the address.
+ *
+ * On a sliced LLC the set an address lands in depends on a hash of the
+ * physical address, so "WAYS lines 2 MiB apart" is an eviction set only
+ * by luck.  Instead a large candidate pool is allocated (hugemem, so huge
+ * pages when available) and every line at the target's offset modulo
+ * `stride` is a candidate.  evset_build() checks that the whole pool
+ * evicts the target, grows a prefix of it until it does, and then reduces
+ * it by group testing (Vila, Koepf, Morales 2019): split the set into
+ * ways + 1 groups, drop any group without which the rest still evicts the
+ * target, repeat until `ways` lines remain.  Every eviction test is a
+ * majority over EVSET_TESTS timed probes against the cacheutils.h
+ * self-test threshold.  A round that finds no removable group splits
+ * finer, and is retried up to EVSET_RETRIES times once it is down to
+ * single lines; a set that stays above `ways` (non-inclusive LLCs) is
+ * kept if it is no larger than EVSET_MAX_WAYS.
+ *
+ * evset_build_all() keeps building sets at one offset until `max` sets are
+ * found, taking each new target from the candidates none of the earlier
+ * sets evicts, which enumerates the distinct cache sets (colour x slice)
+ * that share that offset.  The set index also depends on the line within
+ * the page, so evset_build_every() repeats that for each of the
+ * stride / EVSET_LINE line offsets, which covers every cache set.
+ *
+ * Sets are stored as byte offsets into the pool, so they can be written to
+ * a cache file (evset_save) and read back by a later run (evset_load).
+ * The file records the CPU model, ways, stride, pool size and page kind
+ * and is ignored unless all of them match.  Pool offsets only map to the
+ * same physical lines if the same pages come back, which hugetlbfs usually
+ * does for back-to-back runs and small pages almost never do, so every
+ * loaded set is re-timed and dropped if it no longer evicts its target;
+ * the caller rebuilds whatever is missing.
+ *
+ *  gcc -O2 evsets.c evset.c hugemem.c topology.c timing.c -o evsets -lm
+ */
+#define EVSET_MAX_WAYS   64         /* lines per set */
+#define EVSET_STRIDE     4096       /* candidates share the target's page offset */
+#define EVSET_LINE       64         /* cache line; evset_build_every() steps by it */
+#define EVSET_POOL_LLCS  3          /* default pool size, in LLC sizes */
+#define EVSET_TESTS      5          /* probes per eviction test, majority vote */
+#define EVSET_TRAVERSE   2          /* passes over the set per probe */
+#define EVSET_RETRIES    16         /* reduction rounds allowed to find nothing */
+#define EVSET_CACHE_MAX  4096       /* sets kept per cache file */
+
+struct evset_pool {
+    struct hugemem mem;
+    uint8_t       *base;
+    size_t         bytes;
+    size_t         stride;
+    size_t         ncand;       /* candidates per offset: bytes / stride */
+    int            ways;        /* LLC associativity, the target set size */
+    uint64_t       threshold;   /* probe() cycles above which a line missed the LLC */
+};
+
+struct evset {
+    size_t target;                  /* pool offset of the line this set evicts */
+    int    n;
+    size_t line[EVSET_MAX_WAYS];    /* pool offsets */
+};
+
+/*
+ * Maps `bytes` of candidates (0: EVSET_POOL_LLCS times the LLC) and times
+ * hits against misses for the threshold.  ways <= 0 takes the LLC
+ * associativity from sysfs.  Returns 0, or -1.
+ */
+int  evset_pool_init(struct evset_pool *p, size_t bytes, size_t stride, int ways, int node);
+void evset_pool_free(struct evset_pool *p);
+
+/* Does touching lines[0..n) evict the line at pool offset `target`?  1 or 0. */
+int  evset_evicts(const struct evset_pool *p, size_t target, const size_t *lines, int n);
+
+/* Minimal eviction set for `target`; 0, or -1 if none was found. */
+int  evset_build(struct evset_pool *p, size_t target, struct evset *e);
+/*
+ * Sets for distinct cache sets at page offset `offset`, appended to the
+ * `have` already in sets[] (which are not rebuilt) until there are `max`;
+ * returns the new count.
+ */
+int  evset_build_all(struct evset_pool *p, size_t offset, struct evset *sets, int have, int max);
+/*
+ * evset_build_all() at every line offset of the stride, until each offset
+ * has `per_offset` sets or sets[] holds `max`; returns the new count.
+ */
+int  evset_build_every(struct evset_pool *p, struct evset *sets, int have, int per_offset, int max);
+
+/* CPUID brand string, trimmed. */
+void evset_cpu_model(char *buf, size_t len);
+/* Default cache file for this CPU: "evsets-<model>.txt", model in [A-Za-z0-9_-]. */
+void evset_cache_name(char *buf, size_t len);
+
+int  evset_save(const char *path, const struct evset_pool *p, const struct evset *sets, int n);
+/*
+ * Reads up to `max` sets saved for this CPU and pool, keeping only those
+ * that still evict their target; returns how many were kept (0 if the
+ * file is missing or was made for something else).
+ */
+int  evset_load(const char *path, const struct evset_pool *p, struct evset *sets, int max);
+/*
+ * The set for `target` from the cache file at `path` (NULL: the default
+ * name), built and written back if it is missing or stale.  0, or -1.
+ */
+int  evset_cached(struct evset_pool *p, const char *path, size_t target, struct evset *e);
+
+void evset_print(const struct evset_pool *p, const struct evset *e, const char *who, FILE *f);
+
+#endif
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "evset.h"
+#include "timing.h"
+
+/*
+ * Builds LLC eviction sets (evset.h) and keeps them in the per-CPU cache
+ * file, so the cache-channel programs find them there and start at once.
+ *
+ * Without --all it builds the set for one pool offset, as flush_transmitter
+ * and hit_receiver use; --all N enumerates distinct cache sets at that
+ * page offset until the file holds N sets.  With --every-offset, --all N
+ * asks for N sets at each of the 64 line offsets of a page instead, which
+ * is what covering every cache set takes.  Sets already in the file are
+ * re-timed first and only the missing or stale ones are rebuilt.
+ *
+ *  gcc -O2 evsets.c evset.c hugemem.c topology.c timing.c -o evsets -lm
+ *  ./evsets --offset 0 --all 64
+ *  ./evsets --every-offset --all 16
+ */
+int main(int argc, char *argv[])
+{
+    timing_init();
+
+    size_t      offset  = 0;
+    int         all     = 0;
+    int         every   = 0;
+    size_t      pool_mb = 0;
+    size_t      stride  = 0;
+    int         ways    = 0;
+    int         node    = -1;
+    const char *cache   = NULL;
+    char        name[128];
+
+    for (int i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--offset")  == 0 && i+1 < argc) offset  = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--all")     == 0 && i+1 < argc) all     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--pool-mb") == 0 && i+1 < argc) pool_mb = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--stride")  == 0 && i+1 < argc) stride  = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--ways")    == 0 && i+1 < argc) ways    = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--node")    == 0 && i+1 < argc) node    = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache")   == 0 && i+1 < argc) cache   = argv[++i];
+        else if (strcmp(argv[i], "--every-offset") == 0)           every   = 1;
+        else {
+            fprintf(stderr, "Usage: %s [--offset N | --every-offset] [--all N] [--pool-mb M]\n"
+                            "       [--stride S] [--ways W] [--node N] [--cache FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!cache) {
+        evset_cache_name(name, sizeof(name));
+        cache = name;
+    }
+    if (every && !all) {
+        fprintf(stderr, "evsets: --every-offset needs --all N (sets per line offset)\n");
+        return 1;
+    }
+    if (!every && all > EVSET_CACHE_MAX) all = EVSET_CACHE_MAX;
+
+    struct evset_pool pool;
+    if (evset_pool_init(&pool, pool_mb << 20, stride, ways, node) != 0) return 1;
+    if (offset >= pool.bytes) {
+        fprintf(stderr, "evsets: offset 0x%zx is outside the %zu MiB pool\n", offset, pool.bytes >> 20);
+        evset_pool_free(&pool);
+        return 1;
+    }
+    hugemem_print(&pool.mem, "evsets: pool", stdout);
+    printf("evsets: %d ways, stride %zu, %zu candidates per offset, miss above %llu cycles\n",
+           pool.ways, pool.stride, pool.ncand, (unsigned long long)pool.threshold);
+
+    int rc = 0;
+    double t0 = mysecond();
+
+    if (!all) {
+        struct evset e;
+        if (evset_cached(&pool, cache, offset, &e) != 0) {
+            fprintf(stderr, "evsets: no eviction set found for pool+0x%zx\n", offset);
+            rc = 1;
+        } else {
+            evset_print(&pool, &e, "evsets", stdout);
+        }
+    } else {
+        struct evset *sets = malloc(EVSET_CACHE_MAX * sizeof(*sets));
+        int           n;
+
+        if (!sets) { perror("evsets: malloc"); evset_pool_free(&pool); return 1; }
+        n = evset_load(cache, &pool, sets, EVSET_CACHE_MAX);
+        printf("evsets: %d set(s) from %s still valid (%.3f s)\n", n, cache, mysecond() - t0);
+        if (every) {
+            int m = evset_build_every(&pool, sets, n, all, EVSET_CACHE_MAX);
+            int short_offsets = 0;
+
+            for (size_t off = 0; off < pool.stride; off += EVSET_LINE) {
+                int at = 0;
+                for (int j = 0; j < m; j++) at += sets[j].target % pool.stride == off;
+                short_offsets += at < all;
+            }
+            printf("evsets: built %d set(s) over %zu line offsets, %d offset(s) short of %d\n",
+                   m - n, pool.stride / EVSET_LINE, short_offsets, all);
+            if (short_offsets) rc = 1;
+            if (m > n && evset_save(cache, &pool, sets, m) != 0) rc = 1;
+        } else if (n < all) {
+            int m = evset_build_all(&pool, offset, sets, n, all);
+            printf("evsets: built %d set(s) at page offset 0x%zx\n", m - n, offset % pool.stride);
+            if (m < all) rc = 1;
+            if (evset_save(cache, &pool, sets, m) != 0) rc = 1;
+        }
+        free(sets);
+    }
+    printf("evsets: done in %.3f s, cache %s\n", mysecond() - t0, cache);
+
+    evset_pool_free(&pool);
+    return rc;
+}
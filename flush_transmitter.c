@@ -1,3 +1,11 @@
+/*
+ * Cache covert channel, sender: flushes or primes the shared lines
+ * (cache_channel.h) for each bit.
+ *
+ *  gcc -fopenmp -O2 -pthread flush_transmitter.c cache_channel.c primeprobe.c evset.c \
+ *      sync.c stream_sampler.c ecc.c conv.c kernels.c hugemem.c topology.c timing.c \
+ *      -o flush_transmitter -lm
+ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,65 +13,118 @@
 #include <x86intrin.h>
 #include <unistd.h>
 #include "cacheutils.h"
-#include <sys/time.h>
+#include "hugemem.h"
+#include "evset.h"
+#include "cache_channel.h"
 #include <time.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <math.h>
+#include "timing.h"
 
-#define WAYS 12
-#define C (2 * 1024 * 1024)   // 2 MiB
 #define DURATION 5.0
 
-double mysecond()
-{
-        struct timeval tp;
-        struct timezone tzp;
-        int i;
+int main(int argc, char *argv[]) {
 
-        i = gettimeofday(&tp,&tzp);
-        return ( (double) tp.tv_sec + (double) tp.tv_usec * 1.e-6 );
-}
+    timing_init();
 
-int main(int argc, char *argv[]) {
+    struct cache_calib cal;
+    if (cacheutils_selftest(&cal, CACHE_SELFTEST_ROUNDS) != 0)
+        fprintf(stderr, "flush_transmitter: cached and flushed loads do not separate on this machine\n");
+    cacheutils_print(&cal, "flush_transmitter", 0, stdout);
 
-    int bit = -1;
+    const char *bits = "";
+    const char *mode = "flush";
+    const char *evcache = NULL;
+    int nsets = 1;
+    double chip = CC_CHIP;
+    size_t thrash_mb = 0;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--binary") == 0 && i + 1 < argc)
-            bit = atoi(argv[++i]);
+            bits = argv[++i];
+        else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc)
+            mode = argv[++i];
+        else if (strcmp(argv[i], "--sets") == 0 && i + 1 < argc)
+            nsets = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--chip") == 0 && i + 1 < argc)
+            chip = atof(argv[++i]);
+        else if (strcmp(argv[i], "--thrash-mb") == 0 && i + 1 < argc)
+            thrash_mb = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--evsets") == 0 && i + 1 < argc)
+            evcache = argv[++i];
     }
 
-    if (bit != 0 && bit != 1) {
-        printf("Usage: %s --binary 0|1\n", argv[0]);
+    /* flush: one bit held for DURATION; pp (prime+probe): a clocked payload */
+    int pp = strcmp(mode, "pp") == 0;
+    int nbits = (int)strlen(bits);
+    int valid = nbits > 0 && strspn(bits, "01") == (size_t)nbits &&
+                (pp ? nsets >= 1 && nsets <= PP_MAX_SETS && chip > 0.0
+                    : strcmp(mode, "flush") == 0 && nbits == 1);
+
+    if (!valid) {
+        printf("Usage: %s --binary 0|1 [--evsets FILE]\n"
+               "       %s --mode pp --binary BITS [--sets K] [--chip s] [--thrash-mb M]\n"
+               "          (K bits per window on K cache sets, K at most %d)\n",
+               argv[0], argv[0], PP_MAX_SETS);
         return 1;
     }
 
-    size_t bufsize = WAYS * C + 64;
-    uint8_t *buf = aligned_alloc(64, bufsize);
+    if (pp) {
+        /* thrash the sets whose bit is 1; the receiver primes and probes its own lines */
+        struct pp_thrasher t;
+        struct bitvec payload;
+        if (bitvec_from_string(&payload, bits) != 0)
+            return 1;
+        if (pp_thrasher_init(&t, nsets, thrash_mb << 20, 0, -1) != 0) {
+            bitvec_free(&payload);
+            return 1;
+        }
+        hugemem_print(&t.mem, "transmitter: thrash buffer", stdout);
+
+        size_t windows = cc_windows(payload.nbits, nsets);
+        double start = sync_tx_start(chip);
+        printf("transmitter: %d bits in %zu windows of %.1f us on %d set(s), %zu lines each: "
+               "%.0f bit/s, preamble at %.6f\n", nbits, windows, chip * 1e6, nsets, t.nlines,
+               nsets / chip, start);
+        fflush(stdout);
+        cc_transmit(&t, &payload, chip, start);
+        printf("transmitter: done in %.6f s\n", mysecond() - start);
+
+        pp_thrasher_free(&t);
+        bitvec_free(&payload);
+        return 0;
+    }
+    int bit = bits[0] - '0';
 
-    if (!buf) {
-        perror("alloc");
+    /* a measured eviction set, from the evsets cache file when it is still valid */
+    struct evset_pool pool;
+    struct evset e;
+    if (evset_pool_init(&pool, 0, 0, 0, -1) != 0)
+        return 1;
+    if (evset_cached(&pool, evcache, 0, &e) != 0) {
+        fprintf(stderr, "flush_transmitter: no eviction set found\n");
+        evset_pool_free(&pool);
         return 1;
     }
+    evset_print(&pool, &e, "flush_transmitter", stdout);
 
-    volatile uint8_t *evset[WAYS];
+    volatile uint8_t *evset[EVSET_MAX_WAYS];
+    int ways = e.n;
 
-    for (int i = 0; i < WAYS; i++)
-        evset[i] = buf + i * C;
+    for (int i = 0; i < ways; i++)
+        evset[i] = pool.base + e.line[i];
 
     printf("Transmitting bit %d...\n", bit);
     double end =mysecond() + DURATION;
     while (mysecond() < end) {
         if (bit == 1) {
-            for (int i = 0; i < WAYS; i++)
+            for (int i = 0; i < ways; i++)
                 flush((void*)evset[i]);
-                usleep(500000);  
-        }else{
-            usleep(500000);  
         }
+        usleep(500000);
     }
 
-    free(buf);
+    evset_pool_free(&pool);
     return 0;
 }
\ No newline at end of file
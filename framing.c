@@ -0,0 +1,94 @@
+#include <string.h>
+#include "framing.h"
+
+static uint32_t crc_table[256];
+static int      crc_ready;
+
+static void crc_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+    crc_ready = 1;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n)
+{
+    if (!crc_ready) crc_init();
+    crc = ~crc;
+    while (n--)
+        crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+size_t frame_build(uint8_t *out, uint16_t seq, uint8_t flags,
+                   const uint8_t *payload, size_t len)
+{
+    size_t   n = FRAME_HDR_BYTES;
+    uint32_t crc;
+
+    if (len > FRAME_MAX_PAYLOAD) len = FRAME_MAX_PAYLOAD;
+    out[0] = FRAME_MAGIC;
+    out[1] = seq >> 8;
+    out[2] = seq & 0xff;
+    out[3] = flags;
+    out[4] = (uint8_t)(len >> 8);
+    out[5] = len & 0xff;
+    memcpy(out + n, payload, len);
+    n += len;
+
+    crc = crc32(out, n);
+    out[n++] = crc >> 24;
+    out[n++] = (crc >> 16) & 0xff;
+    out[n++] = (crc >> 8) & 0xff;
+    out[n++] = crc & 0xff;
+    return n;
+}
+
+void frame_rx_init(struct frame_rx *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+enum frame_status frame_rx_push(struct frame_rx *r, int bit)
+{
+    size_t byte = r->nbits >> 3;
+
+    if ((r->nbits & 7) == 0) r->buf[byte] = 0;
+    r->buf[byte] |= (uint8_t)((bit & 1) << (7 - (r->nbits & 7)));
+    r->nbits++;
+
+    /* hunting: slide one bit at a time until the magic lines up */
+    if (r->nbits == 8 && r->buf[0] != FRAME_MAGIC) {
+        r->buf[0] <<= 1;
+        r->nbits = 7;
+        r->hunt++;
+        return FRAME_MORE;
+    }
+    if (r->nbits == 8) r->hunt = 0;
+    if (r->nbits == 8 * FRAME_HDR_BYTES) {
+        size_t len = ((size_t)r->buf[4] << 8) | r->buf[5];
+        if (len > FRAME_MAX_PAYLOAD) {
+            r->nbits = 0;
+            return FRAME_BAD_HEADER;
+        }
+        r->need = FRAME_HDR_BYTES + len + FRAME_CRC_BYTES;
+    }
+    if (!r->need || r->nbits < 8 * r->need)
+        return FRAME_MORE;
+
+    size_t   body = r->need - FRAME_CRC_BYTES;
+    uint32_t crc  = ((uint32_t)r->buf[body] << 24) | ((uint32_t)r->buf[body + 1] << 16) |
+                    ((uint32_t)r->buf[body + 2] << 8) | r->buf[body + 3];
+
+    r->seq     = (uint16_t)((r->buf[1] << 8) | r->buf[2]);
+    r->flags   = r->buf[3];
+    r->length  = (uint16_t)(body - FRAME_HDR_BYTES);
+    r->payload = r->buf + FRAME_HDR_BYTES;
+    r->nbits   = 0;
+    r->need    = 0;
+    return crc == crc32(r->buf, body) ? FRAME_OK : FRAME_BAD_CRC;
+}
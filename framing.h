@@ -0,0 +1,73 @@
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Byte-payload framing for the covert channel.
+ *
+ * A frame on the wire, every field MSB first:
+ *
+ *   magic  8   FRAME_MAGIC
+ *   seq    16  frame number, wraps
+ *   flags  8   FRAME_LAST on the final frame of a payload
+ *   length 16  payload bytes, 0..FRAME_MAX_PAYLOAD
+ *   payload    length bytes
+ *   crc    32  CRC-32 (IEEE 802.3) of everything before it
+ *
+ * The transmitter builds frames with frame_build() and sends their bits;
+ * the receiver feeds decided bits to a frame_rx one at a time and gets a
+ * verdict at the end of each frame, so arbitrarily long payloads stream
+ * through in constant memory.  Between frames, and after a bad header, the
+ * receiver hunts bit by bit for the magic, so a bit error costs the frame
+ * it hits rather than the rest of the transfer; the CRC rejects false locks.
+ */
+#define FRAME_MAGIC       0xC5
+#define FRAME_LAST        0x01
+#define FRAME_HDR_BYTES   6
+#define FRAME_CRC_BYTES   4
+#define FRAME_MAX_PAYLOAD 4096
+#define FRAME_PAYLOAD     32     /* default payload bytes per frame */
+#define FRAME_MAX_BYTES   (FRAME_HDR_BYTES + FRAME_MAX_PAYLOAD + FRAME_CRC_BYTES)
+
+enum frame_status {
+    FRAME_MORE,         /* frame not complete yet */
+    FRAME_OK,           /* complete, CRC good */
+    FRAME_BAD_CRC,      /* complete, CRC mismatch */
+    FRAME_BAD_HEADER,   /* impossible length: back to hunting */
+};
+
+struct frame_rx {
+    uint8_t  buf[FRAME_MAX_BYTES];
+    size_t   nbits;     /* bits collected for the current frame */
+    size_t   need;      /* total bytes of the current frame, 0 until known */
+    size_t   hunt;      /* bits slid past while looking for the magic */
+
+    /* valid after FRAME_OK / FRAME_BAD_CRC */
+    uint16_t seq;
+    uint8_t  flags;
+    uint16_t length;
+    const uint8_t *payload;
+};
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n);
+static inline uint32_t crc32(const uint8_t *p, size_t n)
+{
+    return crc32_update(0, p, n);
+}
+
+/* Writes a frame into out (FRAME_MAX_BYTES); returns its size in bytes. */
+size_t frame_build(uint8_t *out, uint16_t seq, uint8_t flags,
+                   const uint8_t *payload, size_t len);
+
+static inline int frame_bit(const uint8_t *frame, size_t i)
+{
+    return (frame[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+void              frame_rx_init(struct frame_rx *r);
+/* Pushes one bit; after a non-MORE verdict the next bit starts a new frame. */
+enum frame_status frame_rx_push(struct frame_rx *r, int bit);
+
+#endif
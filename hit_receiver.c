@@ -1,3 +1,11 @@
+/*
+ * Cache covert channel, receiver: times loads of the shared lines
+ * against a hit/miss threshold (cacheutils.h).
+ *
+ *  gcc -fopenmp -O2 -pthread hit_receiver.c cache_channel.c primeprobe.c evset.c \
+ *      sync.c stream_sampler.c robust.c ecc.c conv.c kernels.c hugemem.c topology.c \
+ *      timing.c -o hit_receiver -lm
+ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,61 +13,187 @@
 #include <x86intrin.h>
 #include <unistd.h>
 #include "cacheutils.h"
+#include "hugemem.h"
+#include "evset.h"
+#include "cache_channel.h"
+#include "timing.h"
+#include "robust.h"
 #include <sys/time.h>
 #include <time.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <math.h>
+#include <ctype.h>
 
-#ifndef N
-#define N 1
-#endif
-
-#define WAYS 12
-#define C (2 * 1024 * 1024)   // 2 MiB
-#define THRESHOLD 29
-
-size_t repeat_hit(void* addr) {
-    size_t time = rdtsc();
-    for (int i=0; i<N; i++)
-        maccess(addr);
-    size_t delta = rdtsc() - time;
-    delta = delta / 10;   // histogram scaling
-    return delta;
+#define PP_TIMEOUT 60.0      /* seconds to wait for the preamble */
+#define SAMPLES    1024      /* flush mode: timed loads per decision */
+
+/* Default threshold file, one per CPU model like the evsets cache. */
+static void calib_name(char *buf, size_t len)
+{
+    char model[64];
+
+    evset_cpu_model(model, sizeof(model));
+    for (char *c = model; *c; c++)
+        if (!isalnum((unsigned char)*c) && *c != '-') *c = '_';
+    snprintf(buf, len, "threshold-%s.txt", model);
+}
+
+/* Prime+Probe: waits for the preamble and decodes `nbits` clocked bits. */
+static int receive_pp(int nsets, int nbits, double chip, double timeout, const char *evcache)
+{
+    struct pp_receiver r;
+    if (pp_receiver_init(&r, nsets, evcache, -1) != 0)
+        return 1;
+    hugemem_print(&r.pool.mem, "receiver: evset pool", stdout);
+    for (int k = 0; k < nsets; k++)
+        printf("receiver: set %d at +0x%zx, %d lines: quiet %llu, thrashed %llu cycles => threshold %llu\n",
+               k, pp_set_offset(k), r.set[k].n, (unsigned long long)r.set[k].quiet,
+               (unsigned long long)r.set[k].busy, (unsigned long long)r.set[k].threshold);
+
+    struct bitvec rx;
+    double start;
+    if (bitvec_init(&rx, nbits) != 0) {
+        pp_receiver_free(&r);
+        return 1;
+    }
+    printf("receiver: waiting up to %.0f s for the preamble, %.1f us windows\n", timeout, chip * 1e6);
+    fflush(stdout);
+    if (cc_receive(&r, chip, timeout, &rx, NULL, &start) != 0) {
+        fprintf(stderr, "receiver: no preamble\n");
+        bitvec_free(&rx);
+        pp_receiver_free(&r);
+        return 1;
+    }
+
+    double elapsed = mysecond() - start;
+    char *out = malloc((size_t)nbits + 1);
+    if (out) {
+        bitvec_to_string(&rx, out);
+        printf("Decoded bits: %s\n", out);
+        free(out);
+    }
+    printf("receiver: %d bits in %.6f s from the preamble, %.0f bit/s on the payload windows\n",
+           nbits, elapsed, nsets / chip);
+
+    bitvec_free(&rx);
+    pp_receiver_free(&r);
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
 
-    size_t bufsize = WAYS * C + 64;
-    uint8_t *buf = aligned_alloc(64, bufsize);
+    timing_init();
+
+    int hist = 0;
+    int nsets = 1;
+    int nbits = 0;
+    double chip = CC_CHIP;
+    double timeout = PP_TIMEOUT;
+    const char *mode = "flush";
+    const char *evcache = NULL;
+    const char *calfile = NULL;
+    int recalibrate = 0;
+    char name[128];
 
-    if (!buf) {
-        perror("alloc");
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hist") == 0)
+            hist = 1;
+        else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc)
+            mode = argv[++i];
+        else if (strcmp(argv[i], "--sets") == 0 && i + 1 < argc)
+            nsets = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bits") == 0 && i + 1 < argc)
+            nbits = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--chip") == 0 && i + 1 < argc)
+            chip = atof(argv[++i]);
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+            timeout = atof(argv[++i]);
+        else if (strcmp(argv[i], "--evsets") == 0 && i + 1 < argc)
+            evcache = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            calfile = argv[++i];
+        else if (strcmp(argv[i], "--calibrate") == 0)
+            recalibrate = 1;
+    }
+    int pp = strcmp(mode, "pp") == 0;
+    if ((!pp && strcmp(mode, "flush") != 0) || (pp && (nbits < 1 || chip <= 0.0))) {
+        printf("Usage: %s [--evsets FILE] [--threshold FILE] [--calibrate] [--hist]\n"
+               "       %s --mode pp --bits N [--sets K] [--chip s] [--timeout s] [--evsets FILE]\n",
+               argv[0], argv[0]);
         return 1;
     }
 
-    volatile uint8_t *evset[WAYS];
+    struct cache_calib cal;
+    if (cacheutils_selftest(&cal, CACHE_SELFTEST_ROUNDS) != 0)
+        fprintf(stderr, "hit_receiver: cached and flushed loads do not separate on this machine\n");
+    cacheutils_print(&cal, "hit_receiver", hist, stdout);
 
-    for (int i = 0; i < WAYS; i++)
-        evset[i] = buf + i * C;
+    if (pp)
+        return receive_pp(nsets, nbits, chip, timeout, evcache);
 
-    double avg =0;
-    
-    for(int i=0; i< 1024; i++){
-        size_t delta = repeat_hit((void*)evset[0]);
-        avg+=delta;
+    /* a measured eviction set, from the evsets cache file when it is still valid */
+    struct evset_pool pool;
+    struct evset e;
+    if (evset_pool_init(&pool, 0, 0, 0, -1) != 0)
+        return 1;
+    if (evset_cached(&pool, evcache, 0, &e) != 0) {
+        fprintf(stderr, "hit_receiver: no eviction set found\n");
+        evset_pool_free(&pool);
+        return 1;
     }
-    
+    evset_print(&pool, &e, "hit_receiver", stdout);
+
+    volatile uint8_t *evset[EVSET_MAX_WAYS];
+    int ways = e.n;
 
-    avg=avg/(1024*16);
-    printf("Measured time: %f\n", avg);
+    for (int i = 0; i < ways; i++)
+        evset[i] = pool.base + e.line[i];
 
-    if (avg > THRESHOLD) {
-        printf("Decoded bit: 1\n");
+    /*
+     * Hit and miss latencies of the line actually sampled, with the
+     * threshold in the valley between them; measured once per CPU model
+     * and kept in the threshold file until --calibrate asks for a new pass.
+     */
+    if (!calfile) {
+        calib_name(name, sizeof(name));
+        calfile = name;
+    }
+    if (recalibrate || cache_calib_load(calfile, &cal) != 0) {
+        if (cacheutils_calibrate(&cal, (const void *)evset[0], CACHE_SELFTEST_ROUNDS) != 0)
+            fprintf(stderr, "hit_receiver: hits and misses on the target line do not separate\n");
+        else if (cache_calib_save(calfile, &cal) == 0)
+            printf("hit_receiver: threshold saved to %s\n", calfile);
     } else {
-        printf("Decoded bit: 0\n");
+        printf("hit_receiver: threshold from %s\n", calfile);
+    }
+    cacheutils_print(&cal, "hit_receiver: target line", hist, stdout);
+
+    /*
+     * Each timed load votes on its own: a miss means the line was flushed.
+     * Loads the thread was switched out during, or slower than ROBUST_GAP
+     * misses (an interrupt), are dropped before the vote.
+     */
+    static double cycles[SAMPLES];
+    unsigned char switched[SAMPLES];
+    struct robust_window w;
+    int misses = 0;
+
+    for (int i = 0; i < SAMPLES; i++) {
+        long before = robust_switches();
+        cycles[i]   = (double)probe((const void *)evset[0]);
+        switched[i] = robust_switches() != before;
     }
+    robust_filter(cycles, NULL, switched, SAMPLES, ROBUST_GAP * cal.miss_median, &w);
+    int votes = w.fallback ? w.n : w.kept;
+    for (int i = 0; i < votes; i++)
+        misses += cycles[i] >= cal.threshold;
+    robust_print(&w, "hit_receiver", stdout);
+
+    printf("Measured: %d of %d loads at or above %llu cycles\n",
+           misses, votes, (unsigned long long)cal.threshold);
+    printf("Decoded bit: %d\n", 2 * misses > votes);
 
-    free(buf);
+    evset_pool_free(&pool);
     return 0;
-}
\ No newline at end of file
+}
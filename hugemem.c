@@ -0,0 +1,128 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "hugemem.h"
+#include "topology.h"
+#include "timing.h"
+
+#define BASE_PAGE 4096
+
+static size_t round_up(size_t x, size_t to)
+{
+    return (x + to - 1) & ~(to - 1);
+}
+
+/* One store per base page; volatile so the pass is not elided. */
+static double touch(void *p, size_t len)
+{
+    volatile char *b = p;
+    double t = mysecond();
+    for (size_t off = 0; off < len; off += BASE_PAGE)
+        b[off] = 0;
+    return mysecond() - t;
+}
+
+int hugemem_alloc(struct hugemem *m, size_t len, enum hugemem_kind want, int node)
+{
+    void *p = MAP_FAILED;
+
+    memset(m, 0, sizeof(*m));
+    m->len = len;
+
+#ifdef MAP_HUGETLB
+    if (want >= HUGEMEM_HUGETLB) {
+        m->maplen = round_up(len, HUGEMEM_PAGE);
+        p = mmap(NULL, m->maplen, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            m->map  = p;
+            m->p    = p;
+            m->kind = HUGEMEM_HUGETLB;
+        }
+    }
+#endif
+    if (p == MAP_FAILED && want >= HUGEMEM_THP) {
+        /* over-map by one huge page so the buffer can start on a 2 MiB boundary */
+        m->maplen = round_up(len, HUGEMEM_PAGE) + HUGEMEM_PAGE;
+        p = mmap(NULL, m->maplen, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            m->map  = p;
+            m->p    = (void *)round_up((uintptr_t)p, HUGEMEM_PAGE);
+            m->kind = madvise(m->p, round_up(len, HUGEMEM_PAGE), MADV_HUGEPAGE) == 0
+                      ? HUGEMEM_THP : HUGEMEM_SMALL;
+        }
+    }
+    if (p == MAP_FAILED) {
+        m->maplen = round_up(len, BASE_PAGE);
+        p = mmap(NULL, m->maplen, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            perror("hugemem: mmap");
+            memset(m, 0, sizeof(*m));
+            return -1;
+        }
+        m->map  = p;
+        m->p    = p;
+        m->kind = HUGEMEM_SMALL;
+    }
+
+    /* a huge-page mapping can only be split, and so bound, in whole 2 MiB pages */
+    size_t bind = m->kind == HUGEMEM_SMALL ? len : round_up(len, HUGEMEM_PAGE);
+    if (node >= 0 && topology_bind_memory(m->p, bind, node) != 0) {
+        perror("hugemem: mbind");
+        munmap(m->map, m->maplen);
+        memset(m, 0, sizeof(*m));
+        return -1;
+    }
+
+    m->first_touch = touch(m->p, len);
+    m->locked      = mlock(m->p, len) == 0;
+    return 0;
+}
+
+void hugemem_free(struct hugemem *m)
+{
+    if (!m->map) return;
+    if (m->locked) munlock(m->p, m->len);
+    munmap(m->map, m->maplen);
+    memset(m, 0, sizeof(*m));
+}
+
+double hugemem_steady(struct hugemem *m)
+{
+    return touch(m->p, m->len);
+}
+
+const char *hugemem_kind_name(enum hugemem_kind k)
+{
+    switch (k) {
+    case HUGEMEM_HUGETLB: return "hugetlb";
+    case HUGEMEM_THP:     return "thp";
+    default:              return "4k";
+    }
+}
+
+int hugemem_parse_kind(const char *s)
+{
+    if (strcmp(s, "small") == 0 || strcmp(s, "4k") == 0)      return HUGEMEM_SMALL;
+    if (strcmp(s, "thp") == 0)                               return HUGEMEM_THP;
+    if (strcmp(s, "huge") == 0 || strcmp(s, "hugetlb") == 0) return HUGEMEM_HUGETLB;
+    return -1;
+}
+
+void hugemem_print(struct hugemem *m, const char *who, FILE *f)
+{
+    double steady = hugemem_steady(m);
+    size_t pages  = (m->len + BASE_PAGE - 1) / BASE_PAGE;
+
+    fprintf(f, "%s: %.1f MiB on %s pages%s, first touch %.2f ms (%.0f ns/4k), "
+               "steady %.2f ms (%.0f ns/4k)\n",
+            who, m->len / (1024.0 * 1024.0), hugemem_kind_name(m->kind),
+            m->locked ? ", locked" : "",
+            1e3 * m->first_touch, 1e9 * m->first_touch / pages,
+            1e3 * steady, 1e9 * steady / pages);
+}
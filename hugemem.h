@@ -0,0 +1,56 @@
+#ifndef HUGEMEM_H
+#define HUGEMEM_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Large-page, pre-faulted, locked buffers for the measurement kernels.
+ *
+ * hugemem_alloc() tries the requested kind and falls back in order:
+ * hugetlbfs 2 MiB pages (MAP_HUGETLB, needs vm.nr_hugepages), then a
+ * 2 MiB-aligned anonymous mapping with MADV_HUGEPAGE for transparent huge
+ * pages, then plain 4 KiB pages.  The buffer is bound to `node` (if >= 0)
+ * and then written once per base page from the calling thread, so every
+ * page fault happens inside hugemem_alloc() and not in the first sample.
+ * Finally it is mlock()ed; if RLIMIT_MEMLOCK is too small the buffer is
+ * simply left unlocked.
+ *
+ * The pre-fault pass is timed (first_touch) and hugemem_steady() times the
+ * same pass on the resident buffer, which is the cost every later sample
+ * actually sees.
+ */
+#define HUGEMEM_PAGE (2UL * 1024 * 1024)
+
+enum hugemem_kind {
+    HUGEMEM_SMALL,      /* 4 KiB pages */
+    HUGEMEM_THP,        /* transparent huge pages, advised */
+    HUGEMEM_HUGETLB,    /* explicit 2 MiB pages */
+};
+
+struct hugemem {
+    void             *p;
+    size_t            len;          /* requested length */
+    size_t            maplen;       /* mapped length */
+    void             *map;          /* start of the mapping */
+    enum hugemem_kind kind;
+    int               locked;
+    double            first_touch;  /* seconds for the pre-fault pass */
+};
+
+/*
+ * Returns 0 and fills *m, or -1 if even 4 KiB pages could not be mapped or
+ * the buffer could not be bound to `node`.
+ */
+int         hugemem_alloc(struct hugemem *m, size_t len, enum hugemem_kind want, int node);
+void        hugemem_free(struct hugemem *m);
+
+/* Seconds for one write pass over the (already resident) buffer. */
+double      hugemem_steady(struct hugemem *m);
+
+const char *hugemem_kind_name(enum hugemem_kind k);
+/* "small", "thp", "huge" -> kind; -1 if unknown. */
+int         hugemem_parse_kind(const char *s);
+void        hugemem_print(struct hugemem *m, const char *who, FILE *f);
+
+#endif
@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timing.h"
+
+/*
+ * Reports how precisely this host can hit a bit-window schedule.
+ *
+ *  gcc -O2 jitter.c timing.c -o jitter
+ *  ./jitter --n 2000 --period 0.001
+ */
+int main(int argc, char *argv[])
+{
+    int    n      = 2000;
+    double period = 0.001;
+
+    for (int i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--n")      == 0 && i+1 < argc) n      = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--period") == 0 && i+1 < argc) period = atof(argv[++i]);
+        else if (strcmp(argv[i], "--margin") == 0 && i+1 < argc) timing_spin_margin = atof(argv[++i]);
+    }
+    if (n < 1) n = 1;
+
+    timing_init();
+    timing_jitter_bench(n, period);
+    return 0;
+}
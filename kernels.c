@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "kernels.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+/* keeps read-only results alive */
+static volatile double kernel_sink;
+
+static int always(void) { return 1; }
+
+__attribute__((optimize("no-tree-vectorize")))
+static double copy_scalar(double *c, const double *a, size_t n)
+{
+    for (size_t j = 0; j < n; j++)
+        c[j] = a[j];
+    return 0.0;
+}
+
+#ifdef HAVE_X86_KERNELS
+static int has_avx2(void)   { return __builtin_cpu_supports("avx2"); }
+static int has_avx512(void) { return __builtin_cpu_supports("avx512f"); }
+
+/* Vector kernels: scalar head up to `align`, aligned body, scalar tail. */
+static size_t head(const double *c, size_t n, size_t align)
+{
+    size_t h = ((align - ((uintptr_t)c & (align - 1))) & (align - 1)) / sizeof(double);
+    return h < n ? h : n;
+}
+
+__attribute__((target("avx2")))
+static double copy_avx2(double *c, const double *a, size_t n)
+{
+    size_t j = head(c, n, 32);
+    copy_scalar(c, a, j);
+    for (; j + 8 <= n; j += 8) {
+        __m256d x0 = _mm256_loadu_pd(a + j);
+        __m256d x1 = _mm256_loadu_pd(a + j + 4);
+        _mm256_store_pd(c + j,     x0);
+        _mm256_store_pd(c + j + 4, x1);
+    }
+    copy_scalar(c + j, a + j, n - j);
+    return 0.0;
+}
+
+__attribute__((target("avx512f")))
+static double copy_avx512(double *c, const double *a, size_t n)
+{
+    size_t j = head(c, n, 64);
+    copy_scalar(c, a, j);
+    for (; j + 16 <= n; j += 16) {
+        __m512d x0 = _mm512_loadu_pd(a + j);
+        __m512d x1 = _mm512_loadu_pd(a + j + 8);
+        _mm512_store_pd(c + j,     x0);
+        _mm512_store_pd(c + j + 8, x1);
+    }
+    copy_scalar(c + j, a + j, n - j);
+    return 0.0;
+}
+
+static double copy_nt(double *c, const double *a, size_t n)
+{
+    size_t j = head(c, n, 16);
+    copy_scalar(c, a, j);
+    for (; j + 4 <= n; j += 4) {
+        __m128d x0 = _mm_loadu_pd(a + j);
+        __m128d x1 = _mm_loadu_pd(a + j + 2);
+        _mm_stream_pd(c + j,     x0);
+        _mm_stream_pd(c + j + 2, x1);
+    }
+    _mm_sfence();
+    copy_scalar(c + j, a + j, n - j);
+    return 0.0;
+}
+
+static double read_sum(double *c, const double *a, size_t n)
+{
+    __m128d s0 = _mm_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+    double  out[2], sum;
+    size_t  j = 0;
+
+    (void)c;
+    for (; j + 8 <= n; j += 8) {
+        s0 = _mm_add_pd(s0, _mm_loadu_pd(a + j));
+        s1 = _mm_add_pd(s1, _mm_loadu_pd(a + j + 2));
+        s2 = _mm_add_pd(s2, _mm_loadu_pd(a + j + 4));
+        s3 = _mm_add_pd(s3, _mm_loadu_pd(a + j + 6));
+    }
+    _mm_storeu_pd(out, _mm_add_pd(_mm_add_pd(s0, s1), _mm_add_pd(s2, s3)));
+    sum = out[0] + out[1];
+    for (; j < n; j++) sum += a[j];
+    return sum;
+}
+#else
+static double read_sum(double *c, const double *a, size_t n)
+{
+    double sum = 0.0;
+    (void)c;
+    for (size_t j = 0; j < n; j++) sum += a[j];
+    return sum;
+}
+#endif
+
+static const struct mem_kernel kernels[] = {
+    { "scalar", 2, always,     copy_scalar },
+#ifdef HAVE_X86_KERNELS
+    { "avx2",   2, has_avx2,   copy_avx2 },
+    { "avx512", 2, has_avx512, copy_avx512 },
+    { "nt",     2, always,     copy_nt },
+#endif
+    { "read",   1, always,     read_sum },
+};
+#define NKERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static const struct mem_kernel *find(const char *name)
+{
+    for (size_t i = 0; i < NKERNELS; i++)
+        if (strcmp(kernels[i].name, name) == 0) return &kernels[i];
+    return NULL;
+}
+
+const struct mem_kernel *kernel_select(const char *name)
+{
+    const struct mem_kernel *k;
+
+    if (!name || strcmp(name, "auto") == 0) {
+        k = find("avx2");
+        return k && k->supported() ? k : find("scalar");
+    }
+    k = find(name);
+    if (!k) {
+        fprintf(stderr, "kernels: unknown kernel '%s'\n", name);
+        return NULL;
+    }
+    if (!k->supported()) {
+        fprintf(stderr, "kernels: %s is not supported on this CPU\n", name);
+        return NULL;
+    }
+    return k;
+}
+
+void kernel_list(FILE *f)
+{
+    for (size_t i = 0; i < NKERNELS; i++)
+        fprintf(f, "  %-8s %s\n", kernels[i].name,
+                kernels[i].supported() ? "" : "(not supported on this CPU)");
+}
+
+size_t kernel_autosize(const struct mem_kernel *k, double period,
+                       double mbps, size_t llc)
+{
+    double per_elem = (double)k->arrays * sizeof(double);
+    size_t n        = (size_t)(period * mbps * 1.0E6 / per_elem);
+    size_t floor_n  = (size_t)(llc / per_elem);
+    long   pages    = sysconf(_SC_PHYS_PAGES), psize = sysconf(_SC_PAGESIZE);
+
+    if (n < floor_n) n = floor_n;
+    /* callers hold up to three arrays; keep them under half of RAM */
+    if (pages > 0 && psize > 0) {
+        size_t cap = (size_t)pages * (size_t)psize / (6 * sizeof(double));
+        if (n > cap) n = cap;
+    }
+    return n > 0 ? n : 1;
+}
+
+double kernel_run(const struct mem_kernel *k, double *c, const double *a, size_t n)
+{
+    double sum = 0.0;
+
+#pragma omp parallel reduction(+:sum)
+    {
+        size_t lo = 0, hi = n;
+#ifdef _OPENMP
+        size_t nt = (size_t)omp_get_num_threads(), t = (size_t)omp_get_thread_num();
+        lo = n * t / nt;
+        hi = n * (t + 1) / nt;
+#endif
+        sum += k->run(c + lo, a + lo, hi - lo);
+    }
+    kernel_sink = sum;
+    return sum;
+}
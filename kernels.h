@@ -0,0 +1,51 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Explicit memory kernels for the bandwidth channel.
+ *
+ * The plain `c[j] = a[j]` loop is whatever the compiler makes of it; these
+ * pin the instruction mix down so the load a kernel puts on the memory
+ * system (transmitter) and its sensitivity to other traffic (receiver) can
+ * be chosen and compared:
+ *
+ *   scalar   one double per load/store, vectorization disabled
+ *   avx2     256-bit loads and stores
+ *   avx512   512-bit loads and stores
+ *   nt       128-bit loads, non-temporal streaming stores (no RFO)
+ *   read     read-only sum of a[], 128-bit loads, c[] untouched
+ *
+ * Vector variants are compiled with target attributes and only offered
+ * when __builtin_cpu_supports() says the CPU has them.  "auto" picks avx2
+ * when available and scalar otherwise; avx512 is never picked implicitly
+ * because of its frequency licence on older parts.
+ */
+struct mem_kernel {
+    const char *name;
+    int         arrays;     /* arrays streamed per element (for MB/s) */
+    int       (*supported)(void);
+    /* processes [0, n); returns a checksum for read-only kernels */
+    double    (*run)(double *c, const double *a, size_t n);
+};
+
+/* NULL or "auto" gives the default; NULL result if unknown/unsupported. */
+const struct mem_kernel *kernel_select(const char *name);
+void                     kernel_list(FILE *f);
+
+/*
+ * Elements per array so that one pass of k at `mbps` takes about `period`
+ * seconds, but never less than a footprint of `llc` bytes (the pass must
+ * miss in the cache to see memory contention).  llc == 0 means no floor.
+ * The result is capped so three such arrays fit in half of physical RAM.
+ */
+size_t                   kernel_autosize(const struct mem_kernel *k, double period,
+                                         double mbps, size_t llc);
+
+/* Runs k over [0, n) split across the OpenMP team (if any). */
+double                   kernel_run(const struct mem_kernel *k, double *c,
+                                    const double *a, size_t n);
+
+#endif
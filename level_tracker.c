@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <math.h>
+#include "level_tracker.h"
+
+void level_tracker_init(struct level_tracker *lt, double level0, double level1,
+                        double alpha)
+{
+    double spread = 0.1 * (level0 - level1);
+
+    lt->level0    = level0;
+    lt->level1    = level1;
+    lt->var0      = spread * spread;
+    lt->var1      = spread * spread;
+    lt->threshold = 0.5 * (level0 + level1);
+    lt->alpha     = alpha;
+    lt->fixed     = 0;
+    lt->n0        = 0;
+    lt->n1        = 0;
+}
+
+void level_tracker_fix(struct level_tracker *lt, double threshold)
+{
+    lt->threshold = threshold;
+    lt->fixed     = 1;
+}
+
+static void ewma(double *mean, double *var, double x, double alpha)
+{
+    double d = x - *mean;
+    *mean += alpha * d;
+    *var   = (1.0 - alpha) * (*var + alpha * d * d);
+}
+
+char level_tracker_decide(struct level_tracker *lt, double bw)
+{
+    if (bw <= 0.0) return '0';      /* empty window */
+
+    char bit = (bw < lt->threshold) ? '1' : '0';
+    if (lt->fixed) return bit;
+
+    if (bit == '1') { ewma(&lt->level1, &lt->var1, bw, lt->alpha); lt->n1++; }
+    else            { ewma(&lt->level0, &lt->var0, bw, lt->alpha); lt->n0++; }
+
+    /* keep the levels ordered even if a burst of errors drags one across */
+    if (lt->level1 < lt->level0)
+        lt->threshold = 0.5 * (lt->level0 + lt->level1);
+    return bit;
+}
+
+double level_tracker_llr(const struct level_tracker *lt, double bw)
+{
+    if (bw <= 0.0) return 0.0;
+
+    double v0 = lt->var0 > 1.0 ? lt->var0 : 1.0;
+    double v1 = lt->var1 > 1.0 ? lt->var1 : 1.0;
+    double d0 = bw - lt->level0, d1 = bw - lt->level1;
+    double llr = d0 * d0 / (2.0 * v0) - d1 * d1 / (2.0 * v1) + 0.5 * log(v0 / v1);
+
+    if (llr >  LLR_MAX) llr =  LLR_MAX;
+    if (llr < -LLR_MAX) llr = -LLR_MAX;
+    return llr;
+}
@@ -0,0 +1,41 @@
+#ifndef LEVEL_TRACKER_H
+#define LEVEL_TRACKER_H
+
+/*
+ * Drift-tracking decision threshold for the bandwidth receivers.
+ *
+ * Keeps separate exponentially weighted estimates of the idle ('0') and
+ * hammered ('1') bandwidth and their variances.  Every decision updates
+ * the estimate of the level it was assigned to, and the threshold is kept
+ * at the midpoint, so slow changes in background memory traffic move the
+ * threshold with them instead of pushing one level across it.
+ *
+ * The same estimates give a Gaussian soft output: level_tracker_llr()
+ * returns log p(bw | '1') / p(bw | '0'), positive for '1'.
+ */
+#define LEVEL_ALPHA 0.05
+#define LLR_MAX     30.0
+
+struct level_tracker {
+    double level0;      /* idle bandwidth, MB/s */
+    double level1;      /* hammered bandwidth, MB/s */
+    double var0;
+    double var1;
+    double threshold;
+    double alpha;       /* EWMA weight of a new sample */
+    int    fixed;       /* user threshold: decide only, never adapt */
+    long   n0;
+    long   n1;
+};
+
+void level_tracker_init(struct level_tracker *lt, double level0, double level1,
+                        double alpha);
+void level_tracker_fix(struct level_tracker *lt, double threshold);
+
+/* Decides one window ('0' or '1') and folds it into the level estimates. */
+char level_tracker_decide(struct level_tracker *lt, double bw);
+
+/* LLR of one window under the current estimates, clipped to +/-LLR_MAX; 0 if empty. */
+double level_tracker_llr(const struct level_tracker *lt, double bw);
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <pthread.h>
+#include "loopback.h"
+#include "timing.h"
+#include "topology.h"
+#include "sync.h"
+#include "level_tracker.h"
+#include "robust.h"
+
+#define POOL_ELEMS  2000000
+#define MAX_SAMPLES 4096
+
+struct tx_job {
+    struct contention_pool *pool;
+    const struct bitvec    *bits;
+    double                  start;
+    double                  chip;
+};
+
+static double samples[MAX_SAMPLES];
+
+/* Transmitter thread: preamble, guard, then one bit per chip. */
+static void *transmit(void *arg)
+{
+    const struct tx_job *job   = arg;
+    double               start = job->start;
+
+    sync_send_preamble(start, job->chip, contention_pool_chip, NULL, job->pool);
+    start += SYNC_CHIPS * job->chip;
+    for (size_t i = 0; i < job->bits->nbits; i++) {
+        sleep_until(start + i * job->chip);
+        if (bitvec_get(job->bits, i))
+            contention_pool_chip(job->pool, start + (i + 1) * job->chip);
+    }
+    return NULL;
+}
+
+static int receive(struct loopback *lb, double chip, struct bitvec *rx, float *llr)
+{
+    struct sync_result   sync;
+    struct level_tracker lt;
+    double               timeout = SYNC_LEAD + 2 * SYNC_CHIPS * chip + 1.0;
+
+    if (sync_wait(&lb->sampler, chip, timeout, &sync) != 0) return -1;
+    level_tracker_init(&lt, sync.level0, sync.level1, lb->alpha);
+
+    double start = sync.start + SYNC_CHIPS * chip;
+    for (size_t i = 0; i < rx->nbits; i++) {
+        double window_start = start + i * chip;
+        double window_end   = window_start + chip;
+        double bw           = 0.0;
+
+        sleep_until(window_start + chip * 0.01);
+        if (mysecond() <= window_end)
+            bw = robust_stream_window(&lb->sampler, window_end - chip * 0.05,
+                                      samples, MAX_SAMPLES, NULL);
+        if (llr) llr[i] = bw > 0.0 ? (float)level_tracker_llr(&lt, bw) : 0.0f;
+        bitvec_set(rx, i, bw > 0.0 && level_tracker_decide(&lt, bw) == '1');
+    }
+    return 0;
+}
+
+int loopback_start(struct loopback *lb, int nthreads, const struct placement *tx,
+                   const struct placement *rx, const struct mem_kernel *k,
+                   size_t elems, double period)
+{
+    lb->alpha = LEVEL_ALPHA;
+    if (contention_pool_start(&lb->pool, nthreads, POOL_ELEMS, tx) != 0) return -1;
+    contention_pool_set_kernel(&lb->pool, k);
+    if (period > 0.0) {
+        if (stream_sampler_init_period(&lb->sampler, period, rx, k) != 0) {
+            contention_pool_stop(&lb->pool);
+            return -1;
+        }
+    } else {
+        if (stream_sampler_init(&lb->sampler, elems, rx) != 0) {
+            contention_pool_stop(&lb->pool);
+            return -1;
+        }
+        stream_sampler_set_kernel(&lb->sampler, k);
+    }
+    return 0;
+}
+
+void loopback_stop(struct loopback *lb)
+{
+    stream_sampler_free(&lb->sampler);
+    contention_pool_stop(&lb->pool);
+}
+
+int loopback_send(struct loopback *lb, const struct bitvec *bits, double chip,
+                  struct bitvec *rx, float *llr, double *start, double *done)
+{
+    struct tx_job job = { &lb->pool, bits, sync_tx_start(chip), chip };
+    pthread_t     tx;
+    int           rc;
+
+    if (pthread_create(&tx, NULL, transmit, &job) != 0) {
+        perror("loopback: pthread_create");
+        return -1;
+    }
+    rc     = receive(lb, chip, rx, llr);
+    *done  = mysecond();
+    pthread_join(tx, NULL);
+    *start = job.start;
+    return rc == 0 ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+#include "contention_pool.h"
+#include "stream_sampler.h"
+#include "ecc.h"
+
+/*
+ * Both ends of the bandwidth channel in one process, for the measurement
+ * tools (bench, capacity).
+ *
+ * loopback_send() starts a transmitter thread that drives the contention
+ * pool through the Barker preamble and then one bit per chip, while the
+ * calling thread acts as the receiver: sync_wait() on the stream sampler,
+ * then one tracked-threshold decision per window, exactly as the receiver
+ * binaries do.  Both sides read the same mysecond() clock, so the schedule
+ * times reported back are the real ones.
+ */
+struct loopback {
+    struct contention_pool pool;
+    struct stream_sampler  sampler;
+    double                 alpha;       /* level tracker adaptation rate */
+};
+
+struct placement;
+
+/*
+ * nthreads pool workers on tx, the sampler on rx with kernel k for both;
+ * the sampler has `elems` elements, or is sized for `period` seconds per
+ * pass when period > 0.
+ */
+int  loopback_start(struct loopback *lb, int nthreads, const struct placement *tx,
+                    const struct placement *rx, const struct mem_kernel *k,
+                    size_t elems, double period);
+void loopback_stop(struct loopback *lb);
+
+/*
+ * Sends `bits` at `chip` seconds per bit.  rx (already sized like bits)
+ * gets the hard decisions and llr, if not NULL, one LLR per bit.  *start
+ * is the first preamble chip and *done the moment the last window was
+ * decided.  Returns 0, 1 if the receiver never found the preamble, or -1
+ * if the transmitter thread could not be started.
+ */
+int  loopback_send(struct loopback *lb, const struct bitvec *bits, double chip,
+                   struct bitvec *rx, float *llr, double *start, double *done);
+
+#endif
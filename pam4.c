@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <math.h>
+#include "pam4.h"
+
+static const int gray_to_level[4] = { 0, 1, 3, 2 };   /* index b0 << 1 | b1 */
+static const int level_to_gray[4] = { 0, 1, 3, 2 };
+
+int pam4_level(int b0, int b1)
+{
+    return gray_to_level[(b0 & 1) << 1 | (b1 & 1)];
+}
+
+void pam4_bits(int level, int *b0, int *b1)
+{
+    int g = level_to_gray[level & 3];
+    *b0 = g >> 1;
+    *b1 = g & 1;
+}
+
+int pam4_workers(int level, int nthreads)
+{
+    return (level * nthreads + 1) / 3;
+}
+
+int pam4_train(struct pam4_levels *pl, const double *bw, double alpha)
+{
+    double sum[PAM4_LEVELS] = { 0 };
+    int    n[PAM4_LEVELS]   = { 0 };
+    int    k;
+
+    for (k = 0; k < PAM4_TRAIN_LEN; k++) {
+        int l = PAM4_TRAIN[k] - '0';
+        if (bw[k] <= 0.0) continue;
+        sum[l] += bw[k];
+        n[l]++;
+    }
+    /* every centroid is set, 0 for a level without a window, before judging */
+    pl->alpha = alpha;
+    for (k = 0; k < PAM4_LEVELS; k++)
+        pl->c[k] = n[k] ? sum[k] / n[k] : 0.0;
+    for (k = 0; k < PAM4_LEVELS; k++)
+        if (!n[k]) return -1;
+    for (k = 1; k < PAM4_LEVELS; k++)
+        if (pl->c[k] >= pl->c[k - 1]) return -1;
+    return 0;
+}
+
+int pam4_decide(struct pam4_levels *pl, double bw)
+{
+    int best = 0, k;
+
+    if (bw <= 0.0) return -1;
+    for (k = 1; k < PAM4_LEVELS; k++)
+        if (fabs(bw - pl->c[k]) < fabs(bw - pl->c[best])) best = k;
+
+    pl->c[best] += pl->alpha * (bw - pl->c[best]);
+    return best;
+}
@@ -0,0 +1,42 @@
+#ifndef PAM4_H
+#define PAM4_H
+
+/*
+ * Four-level (2 bits/symbol) signalling for the bandwidth channel.
+ *
+ * Symbol level L (0..3) means L/3 of the transmitter's contention workers
+ * are active, so level 0 has the highest receiver bandwidth.  Bit pairs
+ * are Gray-mapped (00, 01, 11, 10 -> 0, 1, 2, 3) so that confusing two
+ * adjacent levels costs one bit.  After the sync preamble the transmitter
+ * sends PAM4_TRAIN, from which the receiver measures the four centroids;
+ * data decisions go to the nearest centroid, which is then nudged toward
+ * the sample like the two-level level_tracker.
+ */
+#define PAM4_LEVELS 4
+#define PAM4_TRAIN  "01233210"
+#define PAM4_TRAIN_LEN 8
+
+struct pam4_levels {
+    double c[PAM4_LEVELS];   /* centroid bandwidth per level, MB/s */
+    double alpha;
+};
+
+/* Gray mapping between a bit pair (b0 first on the wire) and a level. */
+int  pam4_level(int b0, int b1);
+void pam4_bits(int level, int *b0, int *b1);
+
+/* Workers to activate for `level` out of `nthreads`. */
+int  pam4_workers(int level, int nthreads);
+
+/*
+ * Averages training windows: bw[k] was measured during PAM4_TRAIN[k];
+ * empty windows (bw <= 0) are skipped.  Every centroid is set, 0 for a
+ * level with no window.  Returns 0 if all four levels were seen and come
+ * out strictly ordered, -1 otherwise.
+ */
+int  pam4_train(struct pam4_levels *pl, const double *bw, double alpha);
+
+/* Nearest-centroid decision for one window; returns the level, -1 if empty. */
+int  pam4_decide(struct pam4_levels *pl, double bw);
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ * Measures the contention channel for every transmitter/receiver placement.
+ *
+ * Runs the contention pool (transmitter side) and the stream sampler
+ * (receiver side) in one process and toggles the pool on and off for
+ * --rounds windows of --period seconds each.  Per window the receiver's
+ * mean bandwidth is one symbol; the channel SNR is
+ *
+ *     (mu_idle - mu_hammered)^2 / (var_idle + var_hammered)
+ *
+ * over those window means, i.e. what the threshold decoder sees.
+ *
+ * Default sweep: every (transmitter node, receiver node, memory node)
+ * triple, each side on all CPUs of its node (split in half when both sides
+ * share a node).  With --cores, one transmitter and one receiver thread are
+ * swept over every ordered pair of distinct physical cores from --cpus (all
+ * online CPUs by default), memory on --node.  --tx-kernel and --rx-kernel
+ * pick the memory kernels (kernels.h) for the two sides.
+ *
+ *  gcc -fopenmp -O3 -pthread placement_sweep.c contention_pool.c stream_sampler.c \
+ *      topology.c hugemem.c kernels.c timing.c -o placement_sweep -lm
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "timing.h"
+#include "topology.h"
+#include "contention_pool.h"
+#include "stream_sampler.h"
+
+#define SWEEP_PERIOD  0.1
+#define SWEEP_ROUNDS  10
+#define POOL_ELEMS    2000000
+#define SAMPLER_ELEMS 500000
+#define SETTLE        0.1       /* fraction of each window discarded */
+#define MAX_SAMPLES   4096
+
+static struct topology          topo;
+static const struct mem_kernel *tx_kernel, *rx_kernel;
+static double                  samples[MAX_SAMPLES];
+
+struct snr {
+    double mu0, mu1, var0, var1, snr;
+};
+
+static double window_mean(struct stream_sampler *s, double end)
+{
+    int    n   = stream_sampler_run(s, end, samples, NULL, MAX_SAMPLES);
+    double sum = 0.0;
+    int    k0  = (int)(SETTLE * n);
+
+    for (int k = k0; k < n; k++) sum += samples[k];
+    return n > k0 ? sum / (n - k0) : 0.0;
+}
+
+static void mean_var(const double *x, int n, double *mu, double *var)
+{
+    double m = 0.0, v = 0.0;
+    for (int i = 0; i < n; i++) m += x[i];
+    m /= n;
+    for (int i = 0; i < n; i++) v += (x[i] - m) * (x[i] - m);
+    *mu  = m;
+    *var = n > 1 ? v / (n - 1) : 0.0;
+}
+
+static int measure(const struct placement *tx, const struct placement *rx,
+                   int nthreads, double period, int rounds, struct snr *r)
+{
+    struct contention_pool pool;
+    struct stream_sampler  sampler;
+    double idle[rounds], busy[rounds];
+
+    if (contention_pool_start(&pool, nthreads, POOL_ELEMS, tx) != 0) return -1;
+    if (stream_sampler_init(&sampler, SAMPLER_ELEMS, rx) != 0) {
+        contention_pool_stop(&pool);
+        return -1;
+    }
+    contention_pool_set_kernel(&pool, tx_kernel);
+    stream_sampler_set_kernel(&sampler, rx_kernel);
+
+    double t = mysecond() + period;
+    for (int k = 0; k < rounds; k++) {
+        sleep_until(t);
+        idle[k] = window_mean(&sampler, t + period);
+        t += period;
+
+        sleep_until(t);
+        contention_pool_set(&pool, 1);
+        busy[k] = window_mean(&sampler, t + period);
+        contention_pool_set(&pool, 0);
+        t += period;
+    }
+
+    stream_sampler_free(&sampler);
+    contention_pool_stop(&pool);
+
+    mean_var(idle, rounds, &r->mu0, &r->var0);
+    mean_var(busy, rounds, &r->mu1, &r->var1);
+    double d = r->mu0 - r->mu1;
+    r->snr = (r->var0 + r->var1) > 0.0 ? d * d / (r->var0 + r->var1) : INFINITY;
+    return 0;
+}
+
+static void report(const char *tx, const char *rx, int mem, const struct snr *r)
+{
+    printf("%-12s %-12s %4d  %10.0f %10.0f %10.0f %10.0f  %8.2f %7.1f\n",
+           tx, rx, mem, r->mu0, sqrt(r->var0), r->mu1, sqrt(r->var1),
+           r->snr, 10.0 * log10(r->snr));
+    fflush(stdout);
+}
+
+static void header(void)
+{
+    printf("%-12s %-12s %4s  %10s %10s %10s %10s  %8s %7s\n",
+           "tx", "rx", "mem", "idle MB/s", "sd", "busy MB/s", "sd", "SNR", "dB");
+}
+
+/*
+ * First half of pl to tx, the rest to rx, with no CPU in common; a
+ * single-CPU placement goes whole to both.
+ */
+static void split(const struct placement *pl, struct placement *tx, struct placement *rx)
+{
+    int half = pl->ncpus / 2;
+
+    if (half == 0) {
+        *tx = *pl;
+        *rx = *pl;
+        return;
+    }
+    tx->ncpus = half;
+    rx->ncpus = pl->ncpus - half;
+    memcpy(tx->cpus, pl->cpus, half * sizeof(int));
+    memcpy(rx->cpus, pl->cpus + half, rx->ncpus * sizeof(int));
+}
+
+static void sweep_nodes(double period, int rounds)
+{
+    static struct placement tx, rx, both;
+    char  txs[32], rxs[32];
+
+    header();
+    for (int tn = 0; tn < topo.nnodes; tn++)
+    for (int rn = 0; rn < topo.nnodes; rn++)
+    for (int mn = 0; mn < topo.nnodes; mn++) {
+        struct snr r;
+
+        if (placement_from_node(&tx, &topo, tn) != 0 ||
+            placement_from_node(&rx, &topo, rn) != 0)
+            continue;
+        if (tn == rn) {
+            both = tx;
+            split(&both, &tx, &rx);
+        }
+        tx.node = rx.node = mn;
+
+        if (measure(&tx, &rx, tx.ncpus, period, rounds, &r) != 0) continue;
+        snprintf(txs, sizeof(txs), "node%d/%d", tn, tx.ncpus);
+        snprintf(rxs, sizeof(rxs), "node%d/%d", rn, rx.ncpus);
+        report(txs, rxs, mn, &r);
+    }
+}
+
+static int first_of_core(const struct topo_cpu *c)
+{
+    for (int i = 0; i < topo.ncpus && topo.cpus[i].cpu < c->cpu; i++)
+        if (topo.cpus[i].core == c->core && topo.cpus[i].package == c->package)
+            return 0;
+    return 1;
+}
+
+static const struct topo_cpu *find_cpu(int cpu)
+{
+    for (int i = 0; i < topo.ncpus; i++)
+        if (topo.cpus[i].cpu == cpu) return &topo.cpus[i];
+    return NULL;
+}
+
+static void sweep_cores(const struct placement *cand, int node, double period, int rounds)
+{
+    static struct placement tx, rx;
+    int   cores[TOPO_MAX_CPUS], ncores = 0;
+    char  txs[32], rxs[32];
+
+    /* one logical CPU per physical core */
+    for (int i = 0; i < cand->ncpus; i++) {
+        const struct topo_cpu *c = find_cpu(cand->cpus[i]);
+        if (c && first_of_core(c)) cores[ncores++] = c->cpu;
+    }
+    if (ncores < 2) {
+        fprintf(stderr, "placement_sweep: --cores needs at least two physical cores\n");
+        return;
+    }
+
+    header();
+    for (int i = 0; i < ncores; i++)
+    for (int j = 0; j < ncores; j++) {
+        struct snr r;
+        if (i == j) continue;
+
+        tx.ncpus = rx.ncpus = 1;
+        tx.cpus[0] = cores[i];
+        rx.cpus[0] = cores[j];
+        tx.node = rx.node = node;
+
+        if (measure(&tx, &rx, 1, period, rounds, &r) != 0) continue;
+        snprintf(txs, sizeof(txs), "cpu%d", cores[i]);
+        snprintf(rxs, sizeof(rxs), "cpu%d", cores[j]);
+        report(txs, rxs, node, &r);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    timing_init();
+
+    double      period = SWEEP_PERIOD;
+    int         rounds = SWEEP_ROUNDS;
+    int         cores  = 0;
+    const char *cpus   = NULL;
+    int         node   = -1;
+    const char *txk    = NULL;
+    const char *rxk    = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--period") == 0 && i+1 < argc) period = atof(argv[++i]);
+        else if (strcmp(argv[i], "--rounds") == 0 && i+1 < argc) rounds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cpus")   == 0 && i+1 < argc) cpus   = argv[++i];
+        else if (strcmp(argv[i], "--node")   == 0 && i+1 < argc) node   = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cores")  == 0)               cores  = 1;
+        else if (strcmp(argv[i], "--tx-kernel") == 0 && i+1 < argc) txk = argv[++i];
+        else if (strcmp(argv[i], "--rx-kernel") == 0 && i+1 < argc) rxk = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--period s] [--rounds n] [--tx-kernel K] [--rx-kernel K]\n"
+                            "       [--cores [--cpus LIST] [--node N]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rounds < 2 || period <= 0.0) {
+        fprintf(stderr, "placement_sweep: need --rounds >= 2 and --period > 0\n");
+        return 1;
+    }
+
+    if (!(tx_kernel = kernel_select(txk)) || !(rx_kernel = kernel_select(rxk)))
+        return 1;
+    if (topology_load(&topo) != 0) return 1;
+    topology_print(&topo, stdout);
+    printf("\n%d rounds of %.3fs idle + %.3fs hammered per placement, "
+           "tx kernel %s, rx kernel %s\n\n",
+           rounds, period, period, tx_kernel->name, rx_kernel->name);
+
+    if (cores) {
+        static struct placement cand;
+        if (placement_init(&cand, cpus, node) != 0) return 1;
+        if (!cand.ncpus) placement_online(&cand);
+        sweep_cores(&cand, node, period, rounds);
+    } else {
+        sweep_nodes(period, rounds);
+    }
+    return 0;
+}
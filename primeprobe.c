@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "primeprobe.h"
+#include "cacheutils.h"
+#include "topology.h"
+#include "timing.h"
+
+static unsigned xorshift(unsigned *x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+static void shuffle(void **lines, int n, unsigned seed)
+{
+    unsigned x = seed * 2654435761u + 1;
+
+    for (int i = n - 1; i > 0; i--) {
+        int   j = (int)(xorshift(&x) % (unsigned)(i + 1));
+        void *t = lines[i];
+        lines[i] = lines[j];
+        lines[j] = t;
+    }
+}
+
+/* Links lines[0..n), in that order, into a chase through word `slot` of each line. */
+static void *link_chain(void **lines, int n, int slot)
+{
+    for (int i = 0; i < n; i++)
+        ((void **)lines[i])[slot] = (i + 1 < n) ? (void *)((void **)lines[i + 1] + slot) : NULL;
+    return n ? (void **)lines[0] + slot : NULL;
+}
+
+/* Dependent loads to the end of the chain; volatile so none is elided. */
+static void chase(void *p)
+{
+    while (p) p = *(void *volatile *)p;
+}
+
+size_t pp_set_offset(int k)
+{
+    return (size_t)k * PP_SET_STEP;
+}
+
+void pp_set_init(struct pp_set *s, uint8_t *base, const struct evset *e, unsigned seed)
+{
+    void *lines[EVSET_MAX_WAYS] = {0};
+
+    memset(s, 0, sizeof(*s));
+    s->n = e->n;
+    for (int i = 0; i < e->n; i++) lines[i] = base + e->line[i];
+    shuffle(lines, e->n, seed);
+    s->fwd = link_chain(lines, e->n, 0);
+
+    /* the backward chain is the forward order reversed */
+    for (int i = 0; i < e->n / 2; i++) {
+        void *t = lines[i];
+        lines[i] = lines[e->n - 1 - i];
+        lines[e->n - 1 - i] = t;
+    }
+    s->bwd = link_chain(lines, e->n, 1);
+}
+
+void pp_prime(const struct pp_set *s)
+{
+    chase(s->fwd);
+}
+
+uint64_t pp_probe(const struct pp_set *s)
+{
+    uint64_t t0 = rdtsc_begin();
+    chase(s->bwd);
+    return rdtsc_end() - t0;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Threshold between two sorted samples of n: the value that misclassifies
+ * the fewest (quiet at or above it, busy below it), as cache_hist_valley()
+ * does for single loads, placed halfway across the gap it falls in.
+ */
+static uint64_t valley(const uint64_t *q, const uint64_t *b, int n)
+{
+    int      i = 0, j = 0, best = n;
+    uint64_t t = q[0] < b[0] ? q[0] : b[0];
+
+    while (i < n || j < n) {
+        uint64_t v = (j >= n || (i < n && q[i] <= b[j])) ? q[i] : b[j];
+
+        while (i < n && q[i] == v) i++;
+        while (j < n && b[j] == v) j++;
+        /* just above v: n - i quiet probes at or above, j busy ones below */
+        if (n - i + j < best) {
+            uint64_t next = (i < n && (j >= n || q[i] <= b[j])) ? q[i] : j < n ? b[j] : v + 2;
+            best = n - i + j;
+            t    = v + (next - v + 1) / 2;
+        }
+    }
+    return t;
+}
+
+int pp_calibrate(struct pp_set *s, const struct evset_pool *p, size_t target, int rounds)
+{
+    uint64_t *q = malloc((size_t)rounds * sizeof(*q));
+    uint64_t *b = malloc((size_t)rounds * sizeof(*b));
+    size_t    first  = target % PP_SET_PERIOD;
+    size_t    nlines = p->bytes > first ? (p->bytes - first + PP_SET_PERIOD - 1) / PP_SET_PERIOD : 0;
+    size_t    j = 0;
+
+    if (!q || !b) {
+        perror("primeprobe: malloc");
+        free(q);
+        free(b);
+        return -1;
+    }
+    pp_prime(s);
+    for (int i = 0; i < rounds; i++) q[i] = pp_probe(s);
+    for (int i = 0; i < rounds; i++) {
+        /*
+         * What a transmitter does between two probes: one PP_THRASH_CHUNK
+         * of the pool lines that share the set's index, in every slice.
+         */
+        for (int c = 0; c < PP_THRASH_CHUNK && nlines; c++) {
+            maccess(p->base + first + j * PP_SET_PERIOD);
+            j = j + 1 < nlines ? j + 1 : 0;
+        }
+        b[i] = pp_probe(s);
+    }
+    qsort(q, (size_t)rounds, sizeof(*q), cmp_u64);
+    qsort(b, (size_t)rounds, sizeof(*b), cmp_u64);
+    s->quiet     = q[rounds / 2];
+    s->busy      = b[rounds / 2];
+    s->threshold = valley(q, b, rounds);
+    free(q);
+    free(b);
+    return s->busy > s->quiet ? 0 : -1;
+}
+
+/*
+ * pp_set_offset() only picks the cache set when the buffer is on 2 MiB
+ * pages; on 4 KiB pages the two ends would use unrelated sets.
+ */
+static int check_pages(const struct hugemem *m, const char *who)
+{
+    if (m->kind == HUGEMEM_SMALL) {
+        fprintf(stderr, "primeprobe: %s is on 4 KiB pages, but channel sets need 2 MiB pages "
+                        "(set vm.nr_hugepages)\n", who);
+        return -1;
+    }
+    if (m->kind == HUGEMEM_THP)
+        fprintf(stderr, "primeprobe: warning: %s relies on transparent huge pages; the sets only "
+                        "line up where the kernel really backed it with 2 MiB pages\n", who);
+    return 0;
+}
+
+int pp_receiver_init(struct pp_receiver *r, int nsets, const char *evcache, int node)
+{
+    memset(r, 0, sizeof(*r));
+    if (nsets < 1 || nsets > PP_MAX_SETS) {
+        fprintf(stderr, "primeprobe: 1..%d sets, not %d\n", PP_MAX_SETS, nsets);
+        return -1;
+    }
+    if (evset_pool_init(&r->pool, 0, 0, 0, node) != 0) return -1;
+    if (check_pages(&r->pool.mem, "the receiver's pool") != 0) {
+        evset_pool_free(&r->pool);
+        return -1;
+    }
+
+    for (int k = 0; k < nsets; k++) {
+        struct evset e;
+
+        if (evset_cached(&r->pool, evcache, pp_set_offset(k), &e) != 0) {
+            fprintf(stderr, "primeprobe: no eviction set for channel set %d\n", k);
+            evset_pool_free(&r->pool);
+            return -1;
+        }
+        pp_set_init(&r->set[k], r->pool.base, &e, (unsigned)k + 1);
+        if (pp_calibrate(&r->set[k], &r->pool, e.target, PP_CALIB_ROUNDS) != 0)
+            fprintf(stderr, "primeprobe: set %d: thrashed probes are no slower than quiet ones\n", k);
+        r->nsets++;
+    }
+    return 0;
+}
+
+void pp_receiver_free(struct pp_receiver *r)
+{
+    evset_pool_free(&r->pool);
+    r->nsets = 0;
+}
+
+unsigned pp_sample(const struct pp_receiver *r, uint64_t *cycles)
+{
+    unsigned touched = 0;
+
+    for (int k = 0; k < r->nsets; k++) {
+        cycles[k] = pp_probe(&r->set[k]);
+        if (cycles[k] >= r->set[k].threshold) touched |= 1u << k;
+    }
+    return touched;
+}
+
+int pp_thrasher_init(struct pp_thrasher *t, int nsets, size_t bytes, size_t period, int node)
+{
+    memset(t, 0, sizeof(*t));
+    if (nsets < 1 || nsets > PP_MAX_SETS) {
+        fprintf(stderr, "primeprobe: 1..%d sets, not %d\n", PP_MAX_SETS, nsets);
+        return -1;
+    }
+    if (!period) period = PP_SET_PERIOD;
+    if (!bytes)  bytes  = PP_THRASH_LLCS * topology_llc_bytes();
+    if (bytes < period || pp_set_offset(nsets - 1) >= period) {
+        fprintf(stderr, "primeprobe: thrash buffer or set period too small\n");
+        return -1;
+    }
+    if (hugemem_alloc(&t->mem, bytes, HUGEMEM_HUGETLB, node) != 0) return -1;
+    if (check_pages(&t->mem, "the thrash buffer") != 0) {
+        hugemem_free(&t->mem);
+        return -1;
+    }
+
+    t->period = period;
+    t->nlines = bytes / period;
+    for (int k = 0; k < nsets; k++) {
+        if (!(t->line[k] = malloc(t->nlines * sizeof(*t->line[k])))) {
+            perror("primeprobe: malloc");
+            pp_thrasher_free(t);
+            return -1;
+        }
+        t->nsets++;
+        for (size_t j = 0; j < t->nlines; j++)
+            t->line[k][j] = (uint8_t *)t->mem.p + j * period + pp_set_offset(k);
+        shuffle((void **)t->line[k], (int)t->nlines, 0x9e37u + (unsigned)k);
+    }
+    return 0;
+}
+
+void pp_thrasher_free(struct pp_thrasher *t)
+{
+    for (int k = 0; k < t->nsets; k++) free(t->line[k]);
+    hugemem_free(&t->mem);
+    t->nsets = 0;
+}
+
+void pp_thrash(const struct pp_thrasher *t, int k)
+{
+    for (size_t j = 0; j < t->nlines; j++) maccess(t->line[k][j]);
+}
+
+void pp_thrash_until(const struct pp_thrasher *t, unsigned mask, double end)
+{
+    size_t j = 0;
+
+    if (!mask) {
+        sleep_until(end);
+        return;
+    }
+    while (mysecond() < end) {
+        size_t stop = j + PP_THRASH_CHUNK < t->nlines ? j + PP_THRASH_CHUNK : t->nlines;
+
+        for (int k = 0; k < t->nsets; k++) {
+            if (!(mask >> k & 1)) continue;
+            for (size_t i = j; i < stop; i++) maccess(t->line[k][i]);
+        }
+        j = stop < t->nlines ? stop : 0;
+    }
+}
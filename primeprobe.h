@@ -0,0 +1,102 @@
+#ifndef PRIMEPROBE_H
+#define PRIMEPROBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hugemem.h"
+#include "evset.h"
+
+/*
+ * Prime+Probe over the LLC, for a cache channel between processes that
+ * share no memory.
+ *
+ * The receiver owns one eviction set (evset.h) per channel set.  Its lines
+ * are linked into a pointer chase in a random order, forward through the
+ * first word of each line and backward through the second, so every load
+ * depends on the one before and the prefetchers have no stride to follow.
+ * pp_prime() walks the chain forward; pp_probe() walks it backward between
+ * rdtsc_begin() and rdtsc_end() and returns the cycles, which also primes
+ * the set again for the next window (probing in the opposite direction
+ * keeps the probe from evicting its own lines first).  A probe well above
+ * the quiet one means another core touched the set.
+ *
+ * The transmitter has no minimal sets and does not need them: set k lives
+ * at page offset pp_set_offset(k) in both processes, and with 2 MiB pages
+ * that offset fixes the set index bits (below PP_SET_PERIOD), leaving only
+ * the slice unknown.  pp_thrash() touches the lines at that offset in
+ * every PP_SET_PERIOD of a buffer PP_THRASH_LLCS times the LLC, across
+ * all its huge pages, which covers every slice a few times over.  Its
+ * loads are independent (shuffled, but not chased) so they overlap;
+ * pp_thrash_until() keeps the sets of a mask busy until a deadline,
+ * checking the clock every PP_THRASH_CHUNK lines.
+ *
+ * Both buffers must be on 2 MiB pages: the receiver and the thrasher
+ * refuse 4 KiB pages and warn when they only have transparent huge pages.
+ *
+ * Channel set k carries bit k of a symbol, so K sets give K-bit symbols.
+ */
+#define PP_MAX_SETS    16
+#define PP_SET_STEP    0x1100               /* between channel sets: new set index, new page offset */
+#define PP_SET_PERIOD  (128 * 1024)         /* bytes between lines of one set index (2048 sets per slice) */
+#define PP_THRASH_LLCS 2                    /* transmitter buffer, in LLC sizes */
+#define PP_CALIB_ROUNDS 2000
+#define PP_THRASH_CHUNK 64
+
+struct pp_set {
+    void    *fwd;           /* first line of the forward chain */
+    void    *bwd;           /* first line of the backward chain */
+    int      n;
+    uint64_t quiet;         /* median probe cycles, untouched */
+    uint64_t busy;          /* median probe cycles, set thrashed through the pool */
+    uint64_t threshold;     /* at or above: the set was touched */
+};
+
+struct pp_receiver {
+    struct evset_pool pool;
+    struct pp_set     set[PP_MAX_SETS];
+    int               nsets;
+};
+
+struct pp_thrasher {
+    struct hugemem mem;
+    size_t         period;
+    size_t         nlines;                  /* lines per channel set */
+    int            nsets;
+    uint8_t      **line[PP_MAX_SETS];       /* set k's lines, shuffled */
+};
+
+/* Page offset of channel set k; the same in both processes. */
+size_t   pp_set_offset(int k);
+
+/* Links the lines of e (in the pool at base) into a chase shuffled by seed. */
+void     pp_set_init(struct pp_set *s, uint8_t *base, const struct evset *e, unsigned seed);
+void     pp_prime(const struct pp_set *s);
+/* Cycles to walk the set; leaves it primed. */
+uint64_t pp_probe(const struct pp_set *s);
+/*
+ * `rounds` probes of the quiet set, then `rounds` with a PP_THRASH_CHUNK of
+ * the pool's lines congruent to target (the set's pool offset) touched
+ * before each, as a transmitter would; the threshold sits in the valley
+ * between the two distributions.  0, or -1 if thrashing does not slow the
+ * probe.
+ */
+int      pp_calibrate(struct pp_set *s, const struct evset_pool *p, size_t target, int rounds);
+
+/*
+ * Eviction sets for channel sets 0..nsets-1 from the evset cache (built
+ * where missing), linked and calibrated.  0, or -1.
+ */
+int      pp_receiver_init(struct pp_receiver *r, int nsets, const char *evcache, int node);
+void     pp_receiver_free(struct pp_receiver *r);
+/* Probes every set once: cycles[k], and the return value has bit k set if set k was touched. */
+unsigned pp_sample(const struct pp_receiver *r, uint64_t *cycles);
+
+/* bytes = 0: PP_THRASH_LLCS times the LLC; period = 0: PP_SET_PERIOD. */
+int      pp_thrasher_init(struct pp_thrasher *t, int nsets, size_t bytes, size_t period, int node);
+void     pp_thrasher_free(struct pp_thrasher *t);
+/* One pass over the lines of channel set k. */
+void     pp_thrash(const struct pp_thrasher *t, int k);
+/* Thrashes the sets in `mask` (bit k = set k) until mysecond() reaches end; sleeps if mask is 0. */
+void     pp_thrash_until(const struct pp_thrasher *t, unsigned mask, double end);
+
+#endif
@@ -1,170 +1,481 @@
-
-
+/*
+ * Memory-bandwidth covert channel, receiver: STREAM Copy passes
+ * (stream_sampler.h) in every bit window, decided against a running threshold.
+ *
+ *  gcc -fopenmp -O3 -pthread receiver.c stream_sampler.c robust.c sync.c trace.c level_tracker.c \
+ *      pam4.c contention_pool.c topology.c hugemem.c kernels.c framing.c arq.c timing.c \
+ *      -o receiver -lm
+ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
-#include <signal.h>
-#include <sys/wait.h>
-#include <fcntl.h>
-#include <sys/time.h>
 #include <math.h>
+#include "timing.h"
+#include "stream_sampler.h"
+#include "sync.h"
+#include "topology.h"
+#include "trace.h"
+#include "level_tracker.h"
+#include "pam4.h"
+#include "framing.h"
+#include "arq.h"
+#include "contention_pool.h"
+#include "robust.h"
 
-#define SYNC_FILE    "/tmp/covert_start"
 #define BIT_DURATION 0.1
 #define DEFAULT_BITS 16
+#define FRAME_HUNT_LIMIT 64     /* idle bits before framed mode gives up */
+#define SAMPLER_ELEMS 4000000
+#define ACK_POOL_ELEMS 2000000
+#define MAX_SAMPLES  4096
+#define SYNC_TIMEOUT 60.0
+#define TRACE_CAP    (1 << 20)
+#define PHASE_SEARCH 0.25
+#define PHASE_STEPS  8
+#define SLICE_GUARD  0.05
 
-double mysecond()
+static struct stream_sampler  sampler;
+static struct contention_pool ack_pool;   /* --arq: answers the transmitter */
+static double                 samples[MAX_SAMPLES];
+
+static void receive_live(double start_time, int num_bits,
+                         struct level_tracker *lt, char *received)
 {
-        struct timeval tp;
-        struct timezone tzp;
-        int i;
+    for (int i = 0; i < num_bits; i++) {
+        double window_start = start_time + i * BIT_DURATION;
+        double window_end   = window_start + BIT_DURATION;
 
-        i = gettimeofday(&tp,&tzp);
-        return ( (double) tp.tv_sec + (double) tp.tv_usec * 1.e-6 );
-}
+        sleep_until(window_start+BIT_DURATION*0.01);
+        if(mysecond() > window_end){
+            printf("receiver: [bit %d] missed window setting to x...\n", i);
+            fflush(stdout);
+            char bit = '0';
+            received[i] = bit;
+        }else{
+            printf("receiver: [bit %d] window open, running simple_stream at time = %.3f...\n", i, mysecond());
+            fflush(stdout);
 
-static void sleep_until(double target)
-{
-    double remaining = target - mysecond();
-    if (remaining <= 0.0) return;
-    struct timespec ts;
-    ts.tv_sec  = (time_t)remaining;
-    ts.tv_nsec = (long)((remaining - ts.tv_sec) * 1e9);
-    nanosleep(&ts, NULL);
+            struct robust_window w;
+            double bw  = robust_stream_window(&sampler, window_end-BIT_DURATION*0.05,
+                                              samples, MAX_SAMPLES, &w);
+            double threshold = lt->threshold;
+            robust_print(&w, "receiver", stdout);
+            char   bit = level_tracker_decide(lt, bw);
+            received[i] = bit;
+
+            printf("receiver: bit %2d | Copy rate = %8.0f MB/s | threshold = %.0f | decoded = '%c' \n\n", i, bw, threshold, bit);
+            fflush(stdout);
+        }
+
+    }
 }
 
-static double run_simple_stream(double until)
+/*
+ * Framed mode: decides one bit per window and feeds a frame_rx until the
+ * frame flagged FRAME_LAST, or until FRAME_HUNT_LIMIT windows pass without
+ * a frame start.  Good payloads go to out; frames that fail the CRC and
+ * gaps in the sequence numbers are reported.  Returns 0 if every frame up
+ * to the last one arrived intact.
+ */
+static int receive_framed(double start_time, struct level_tracker *lt, FILE *out)
 {
-    double sum   = 0.0;
-    int    count = 0;
-
-    while (mysecond() < until) {
-        int pipefd[2];
-        if (pipe(pipefd) == -1) { perror("pipe"); break; }
-
-        pid_t pid = fork();
-        if (pid == 0) {
-            close(pipefd[0]);
-            dup2(pipefd[1], STDOUT_FILENO);
-            dup2(pipefd[1], STDERR_FILENO);
-            close(pipefd[1]);
-            execl("./simple_stream", "simple_stream", NULL);
-            perror("execl");
-            _exit(1);
-        } else if (pid < 0) {
-            perror("fork");
-            close(pipefd[0]); close(pipefd[1]);
+    struct frame_rx fr;
+    size_t   good = 0, bad = 0, missed = 0, bytes = 0;
+    uint16_t expect = 0;
+    int      last = 0;
+
+    frame_rx_init(&fr);
+    for (size_t i = 0; !last; i++) {
+        double window_start = start_time + i * BIT_DURATION;
+        double window_end   = window_start + BIT_DURATION;
+        char   bit          = '0';
+
+        sleep_until(window_start+BIT_DURATION*0.01);
+        if (mysecond() <= window_end)
+            bit = level_tracker_decide(lt, robust_stream_window(&sampler, window_end-BIT_DURATION*0.05,
+                                                                samples, MAX_SAMPLES, NULL));
+
+        switch (frame_rx_push(&fr, bit == '1')) {
+        case FRAME_MORE:
+            if (fr.hunt > FRAME_HUNT_LIMIT) {
+                printf("receiver: no frame start for %d bits, giving up at bit %zu\n",
+                       FRAME_HUNT_LIMIT, i);
+                last = -1;
+            }
+            continue;
+        case FRAME_OK:
+            if (fr.seq != expect) {
+                printf("receiver: frame(s) %u..%u missing\n", expect, (uint16_t)(fr.seq - 1));
+                missed += (uint16_t)(fr.seq - expect);
+            }
+            expect = fr.seq + 1;
+            fwrite(fr.payload, 1, fr.length, out);
+            fflush(out);
+            good++;
+            bytes += fr.length;
+            last   = fr.flags & FRAME_LAST;
+            printf("receiver: frame %u ok, %u byte(s)%s\n", fr.seq, fr.length,
+                   last ? ", last" : "");
+            break;
+        case FRAME_BAD_CRC:
+            bad++;
+            printf("receiver: frame %u failed CRC, %u byte(s) dropped\n", fr.seq, fr.length);
+            break;
+        case FRAME_BAD_HEADER:
+            bad++;
+            printf("receiver: bad frame header at bit %zu, resyncing\n", i);
             break;
         }
+        fflush(stdout);
+    }
+    printf("receiver: %zu frame(s) ok, %zu failed, %zu missing, %zu byte(s) written\n",
+           good, bad, missed, bytes);
+    return last > 0 && !bad && !missed ? 0 : -1;
+}
 
-        close(pipefd[1]);
+/* Drives the reverse slots of one ARQ round with the ack pool. */
+static void answer_round(double round_start, size_t chunk, int ack)
+{
+    for (int k = 0; k < ARQ_ACK_SLOTS; k++) {
+        double slot_start = round_start + arq_ack_slot(chunk, k) * BIT_DURATION;
+        sleep_until(slot_start);
+        contention_pool_set(&ack_pool, arq_ack_chip(ack, k));
+        sleep_until(slot_start + BIT_DURATION);
+    }
+    contention_pool_set(&ack_pool, 0);
+}
 
-        while (1) {
-            if (mysecond() >= until) {
-                kill(pid, SIGKILL);
-                waitpid(pid, NULL, 0);
-                close(pipefd[0]);
-                goto done;          
-            }
-            int   status;
-            pid_t r = waitpid(pid, &status, WNOHANG);
-            if (r == pid) break;    
-            usleep(1000);
+/*
+ * ARQ mode (arq.h): one frame per round, answered in the round's reverse
+ * slots.  A repeat of the frame already written is acknowledged again but
+ * not written twice.  Ends one round after the last frame was written if
+ * the transmitter has gone quiet, or after ARQ_RETRIES + 1 rounds in a row
+ * without a good frame.
+ */
+static int receive_arq(double start_time, struct level_tracker *lt, FILE *out, size_t chunk)
+{
+    struct frame_rx fr;
+    size_t   round_slots = arq_round_slots(chunk), frame_slots = arq_frame_slots(chunk);
+    size_t   good = 0, failed = 0, repeats = 0, bytes = 0, quiet = 0;
+    uint16_t expect = 0;
+    int      done = 0;
+
+    for (size_t round = 0; ; round++) {
+        double round_start = start_time + round * round_slots * BIT_DURATION;
+        int    status = FRAME_MORE, ack;
+
+        frame_rx_init(&fr);
+        for (size_t i = 0; i < frame_slots && status == FRAME_MORE && !fr.hunt; i++) {
+            double window_start = round_start + i * BIT_DURATION;
+            double window_end   = window_start + BIT_DURATION;
+            char   bit          = '0';
+
+            sleep_until(window_start+BIT_DURATION*0.01);
+            if (mysecond() <= window_end)
+                bit = level_tracker_decide(lt, robust_stream_window(&sampler, window_end-BIT_DURATION*0.05,
+                                                                samples, MAX_SAMPLES, NULL));
+            status = frame_rx_push(&fr, bit == '1');
         }
 
-        char    accum[65536];
-        int     accum_len = 0;
-        char    tmp[4096];
-        ssize_t n;
-        while ((n = read(pipefd[0], tmp, sizeof(tmp) - 1)) > 0) {
-            if (accum_len + n < (int)sizeof(accum) - 1) {
-                memcpy(accum + accum_len, tmp, n);
-                accum_len += n;
-            }
+        if (status == FRAME_OK && fr.seq == expect) {
+            fwrite(fr.payload, 1, fr.length, out);
+            fflush(out);
+            good++;
+            bytes += fr.length;
+            expect++;
+            done = fr.flags & FRAME_LAST;
+            printf("receiver: round %zu, frame %u ok, %u byte(s)%s\n", round, fr.seq,
+                   fr.length, done ? ", last" : "");
+        } else if (status == FRAME_OK && fr.seq == (uint16_t)(expect - 1)) {
+            repeats++;
+            printf("receiver: round %zu, frame %u repeated, acknowledging again\n", round, fr.seq);
+        } else if (status == FRAME_MORE && fr.hunt && done) {
+            printf("receiver: round %zu, transmitter quiet, done\n", round);
+            break;
+        } else {
+            failed++;
+            printf("receiver: round %zu, %s, asking for a resend\n", round,
+                   status == FRAME_BAD_CRC  ? "CRC failed" :
+                   status == FRAME_OK       ? "unexpected sequence number" :
+                   fr.hunt                  ? "no frame start" : "bad header");
+        }
+        ack   = status == FRAME_OK && fr.seq == (uint16_t)(expect - 1);
+        quiet = ack ? 0 : quiet + 1;
+        fflush(stdout);
+        answer_round(round_start, chunk, ack);
+        if (quiet > ARQ_RETRIES) {
+            printf("receiver: %d rounds without a good frame, giving up\n", ARQ_RETRIES + 1);
+            break;
         }
-        close(pipefd[0]);
-
-        accum[accum_len] = '\0';
-        char *line = strtok(accum, "\n");
-        while (line) {
-            if (strncmp(line, "Copy:", 5) == 0) {
-                char *p = line + 5;
-                while (*p == ' ' || *p == '\t') p++;
-                double bw = atof(p);
-                if (bw > 0.0) { sum += bw; count++; }
+    }
+    printf("receiver: %zu frame(s) ok, %zu resend(s) requested, %zu repeat(s), %zu byte(s) written\n",
+           good, failed, repeats, bytes);
+    return done ? 0 : -1;
+}
+
+/* 0, or -1 if training did not give four ordered levels. */
+static int receive_pam4(double start_time, int num_bits, double alpha,
+                        char *received)
+{
+    struct pam4_levels pl;
+    double train[PAM4_TRAIN_LEN];
+    int    nsym = PAM4_TRAIN_LEN + (num_bits + 1) / 2;
+
+    for (int s = 0; s < nsym; s++) {
+        double window_start = start_time + s * BIT_DURATION;
+        double window_end   = window_start + BIT_DURATION;
+
+        sleep_until(window_start+BIT_DURATION*0.01);
+        struct robust_window w = {0};
+        double bw = mysecond() > window_end ? 0.0
+                  : robust_stream_window(&sampler, window_end-BIT_DURATION*0.05,
+                                         samples, MAX_SAMPLES, &w);
+        robust_print(&w, "receiver", stdout);
+
+        if (s < PAM4_TRAIN_LEN) {
+            train[s] = bw;
+            if (s == PAM4_TRAIN_LEN - 1) {
+                int rc = pam4_train(&pl, train, alpha);
+                printf("receiver: PAM-4 centroids = %.0f / %.0f / %.0f / %.0f MB/s\n\n",
+                       pl.c[0], pl.c[1], pl.c[2], pl.c[3]);
+                if (rc != 0) {
+                    fprintf(stderr, "receiver: PAM-4 training failed (a level is missing or out of order)\n");
+                    return -1;
+                }
             }
-            line = strtok(NULL, "\n");
+            continue;
         }
-        usleep(1000);
+
+        int level = pam4_decide(&pl, bw), b0, b1;
+        int i     = 2 * (s - PAM4_TRAIN_LEN);
+        pam4_bits(level < 0 ? 0 : level, &b0, &b1);
+        received[i] = b0 ? '1' : '0';
+        if (i + 1 < num_bits) received[i + 1] = b1 ? '1' : '0';
+
+        printf("receiver: symbol %2d | Copy rate = %8.0f MB/s | level = %d | decoded = '%d%d' \n",
+               s - PAM4_TRAIN_LEN, bw, level, b0, b1);
+        fflush(stdout);
     }
+    return 0;
+}
+
+static int decode_trace(const struct trace *tr, int num_bits,
+                        struct level_tracker *lt, double search, char *received)
+{
+    struct slice_params p = {
+        .start     = tr->start,
+        .symbol    = tr->symbol,
+        .nsymbols  = num_bits,
+        .threshold = lt->threshold,
+        .search    = search,
+        .steps     = PHASE_STEPS,
+        .guard     = SLICE_GUARD,
+    };
+    double *levels = malloc(num_bits * sizeof(double));
+    double  phase  = 0.0;
+
+    if (!levels) { fprintf(stderr, "malloc failed\n"); return -1; }
+    if (trace_slice(tr, &p, levels, received, &phase) != 0) { free(levels); return -1; }
 
-done:
-    if (count == 0) return 0.0;
-    printf("receiver: averaged %d sample(s)\n", count);
-    return sum / count;
+    printf("receiver: sliced %d symbols from %zu samples, phase %+.1f us\n",
+           num_bits, tr->count, phase * 1e6);
+    /* phase was picked with the starting threshold; decide again with tracking */
+    for (int i = 0; i < num_bits; i++) {
+        double threshold = lt->threshold;
+        received[i] = level_tracker_decide(lt, levels[i]);
+        printf("receiver: bit %2d | Copy rate = %8.0f MB/s | threshold = %.0f | decoded = '%c' \n",
+               i, levels[i], threshold, received[i]);
+    }
+    printf("\n");
+
+    free(levels);
+    return 0;
 }
 
 int main(int argc, char *argv[])
 {
-    int    num_bits  = DEFAULT_BITS;
-    double threshold = 0.0;
+    timing_init();
+
+    int         num_bits  = DEFAULT_BITS;
+    double      threshold = 0.0;
+    long        elems     = SAMPLER_ELEMS;
+    double      period    = 0.0;
+    double      timeout   = SYNC_TIMEOUT;
+    const char *cpus      = NULL;
+    const char *kernel    = NULL;
+    int         node      = -1;
+    int         capture   = 0;
+    double      search    = PHASE_SEARCH;
+    double      alpha     = LEVEL_ALPHA;
+    int         pam4      = 0;
+    const char *trace_in  = NULL;
+    const char *trace_out = NULL;
+    const char *out_path  = NULL;
+    FILE       *out       = NULL;
+    int         arq       = 0;
+    long        chunk     = FRAME_PAYLOAD;
+    int         ack_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *ack_cpus  = NULL;
 
     for (int i = 1; i < argc; i++) {
         if      (strcmp(argv[i], "--bits")      == 0 && i+1 < argc) num_bits  = atoi(argv[++i]);
         else if (strcmp(argv[i], "--threshold") == 0 && i+1 < argc) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--elems")     == 0 && i+1 < argc) elems     = atol(argv[++i]);
+        else if (strcmp(argv[i], "--sample-period") == 0 && i+1 < argc) period = atof(argv[++i]);
+        else if (strcmp(argv[i], "--cpus")      == 0 && i+1 < argc) cpus      = argv[++i];
+        else if (strcmp(argv[i], "--node")      == 0 && i+1 < argc) node      = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--kernel")    == 0 && i+1 < argc) kernel    = argv[++i];
+        else if (strcmp(argv[i], "--sync-timeout") == 0 && i+1 < argc) timeout = atof(argv[++i]);
+        else if (strcmp(argv[i], "--capture")   == 0)               capture   = 1;
+        else if (strcmp(argv[i], "--phase-search") == 0 && i+1 < argc) search = atof(argv[++i]);
+        else if (strcmp(argv[i], "--alpha")     == 0 && i+1 < argc) alpha     = atof(argv[++i]);
+        else if (strcmp(argv[i], "--pam4")      == 0)               pam4      = 1;
+        else if (strcmp(argv[i], "--trace-out") == 0 && i+1 < argc) { trace_out = argv[++i]; capture = 1; }
+        else if (strcmp(argv[i], "--trace-in")  == 0 && i+1 < argc) trace_in  = argv[++i];
+        else if (strcmp(argv[i], "--out")       == 0 && i+1 < argc) out_path  = argv[++i];
+        else if (strcmp(argv[i], "--arq")       == 0)               arq       = 1;
+        else if (strcmp(argv[i], "--frame")     == 0 && i+1 < argc) chunk     = atol(argv[++i]);
+        else if (strcmp(argv[i], "--ack-threads") == 0 && i+1 < argc) ack_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ack-cpus")  == 0 && i+1 < argc) ack_cpus  = argv[++i];
     }
 
-    printf("receiver: calibrating baseline (transmitter not yet active)...\n");
-    fflush(stdout);
-    double baseline = run_simple_stream(mysecond()+2);
-
-    if (threshold <= 0.0) {
-        threshold = baseline * 0.9;
-        printf("receiver: baseline = %.0f MB/s  =>  threshold = %.0f MB/s\n\n",
-               baseline, threshold);
-    } else {
-        printf("receiver: baseline = %.0f MB/s, using fixed threshold = %.0f MB/s\n\n",
-               baseline, threshold);
+    if (pam4 && (capture || trace_in)) {
+        fprintf(stderr, "receiver: --pam4 is only supported in live mode\n");
+        return 1;
+    }
+    if (out_path && (pam4 || capture || trace_in)) {
+        fprintf(stderr, "receiver: --out is only supported in live binary mode\n");
+        return 1;
+    }
+    if (arq && (!out_path || chunk < 1 || chunk > FRAME_MAX_PAYLOAD)) {
+        fprintf(stderr, "receiver: --arq needs --out and 1 <= --frame <= %d\n", FRAME_MAX_PAYLOAD);
+        return 1;
+    }
+    if (out_path && strcmp(out_path, "-") == 0) {
+        /* payload keeps stdout, the log moves to stderr */
+        int fd = dup(STDOUT_FILENO);
+        if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0 || !(out = fdopen(fd, "wb"))) {
+            perror("receiver: stdout");
+            return 1;
+        }
+    } else if (out_path && !(out = fopen(out_path, "wb"))) {
+        perror(out_path);
+        return 1;
     }
-    fflush(stdout);
-
-    double start_time = floor(mysecond() / 60.0) * 60.0 + 60.0;;
-    
 
     char *received = (char *)malloc(num_bits + 1);
     if (!received) { fprintf(stderr, "malloc failed\n"); return 1; }
 
-    for (int i = 0; i < num_bits; i++) { //implement something that checks current time and if it's current time is ahead of where it should be just mark that bit as x
-        double window_start = start_time + i * BIT_DURATION;
-        double window_end   = window_start + BIT_DURATION;
+    struct trace         tr;
+    struct level_tracker lt;
 
-        sleep_until(window_start+BIT_DURATION*0.01);
-        if(mysecond() > window_end){
-            printf("receiver: [bit %d] missed window setting to x...\n", i);
-            fflush(stdout);
-            char bit = '0';
-            received[i] = bit;
-        }else{
-            printf("receiver: [bit %d] window open, running simple_stream at time = %.3f...\n", i, mysecond());
-            fflush(stdout);
+    if (trace_in) {
+        /* offline re-decode: no channel, no sampler */
+        if (trace_load(&tr, trace_in) != 0) return 1;
+        level_tracker_init(&lt, tr.level0, tr.level1, alpha);
+        if (threshold > 0.0) level_tracker_fix(&lt, threshold);
+        printf("receiver: %s: %zu samples, idle = %.0f MB/s, hammered = %.0f MB/s\n",
+               trace_in, tr.count, tr.level0, tr.level1);
+        if (decode_trace(&tr, num_bits, &lt, search, received) != 0) return 1;
+        trace_free(&tr);
+    } else {
+        struct placement         pl;
+        const struct mem_kernel *k = kernel_select(kernel);
+        if (!k || placement_init(&pl, cpus, node) != 0) return 1;
+        placement_print(&pl, "receiver", stdout);
+        if (period > 0.0) {
+            if (stream_sampler_init_period(&sampler, period, &pl, k) != 0) return 1;
+        } else {
+            if (stream_sampler_init(&sampler, (size_t)elems, &pl) != 0) return 1;
+            stream_sampler_set_kernel(&sampler, k);
+        }
+        printf("receiver: sampling with the %s kernel, %zu elements, %.3f ms per pass\n",
+               k->name, sampler.n, 1e3 * sampler.last_pass);
+        hugemem_print(&sampler.ma, "receiver: sampler", stdout);
+        if (arq) {
+            /*
+             * Without --ack-cpus the pool shares the sampler's cores: its
+             * workers only run in the ACK slots, when nothing is sampled,
+             * and park on the gate otherwise (contention_pool.h).
+             */
+            struct placement ackpl = pl;
+            if (ack_cpus && placement_init(&ackpl, ack_cpus, node) != 0) return 1;
+            if (ack_cpus) placement_print(&ackpl, "receiver: ack pool", stdout);
+            if (contention_pool_start(&ack_pool, ack_threads, ACK_POOL_ELEMS, &ackpl) != 0) return 1;
+            contention_pool_set_kernel(&ack_pool, k);
+            printf("receiver: ARQ, %zu slots per round, answering with %d worker(s)\n",
+                   arq_round_slots((size_t)chunk), ack_threads);
+        }
+        if (capture && trace_init(&tr, TRACE_CAP) != 0) return 1;
 
-            double bw  = run_simple_stream(window_end-BIT_DURATION*0.05);
-            char   bit = (bw < threshold) ? '1' : '0';
-            received[i] = bit;
+        printf("receiver: waiting for preamble...\n");
+        fflush(stdout);
 
-            printf("receiver: bit %2d | Copy rate = %8.0f MB/s | threshold = %.0f | decoded = '%c' \n\n", i, bw, threshold, bit);
-            fflush(stdout);
+        struct sync_result sync;
+        if (sync_wait(&sampler, BIT_DURATION, timeout, &sync) != 0) {
+            fprintf(stderr, "receiver: no preamble within %.0fs\n", timeout);
+            return 1;
+        }
+        printf("receiver: preamble at %.6f (corr %.2f, clock offset %+.1f us)\n",
+               sync.start, sync.corr, sync.offset * 1e6);
+
+        double baseline = sync.level0;
+        level_tracker_init(&lt, sync.level0, sync.level1, alpha);
+        if (threshold <= 0.0) {
+            printf("receiver: idle = %.0f MB/s, hammered = %.0f MB/s  =>  threshold = %.0f MB/s (tracking)\n\n",
+                   sync.level0, sync.level1, lt.threshold);
+        } else {
+            level_tracker_fix(&lt, threshold);
+            printf("receiver: baseline = %.0f MB/s, using fixed threshold = %.0f MB/s\n\n",
+                   baseline, threshold);
         }
+        fflush(stdout);
 
+        double start_time = sync.start + SYNC_CHIPS * BIT_DURATION;
+
+        if (capture) {
+            tr.start  = start_time;
+            tr.symbol = BIT_DURATION;
+            tr.level0 = sync.level0;
+            tr.level1 = sync.level1;
+            trace_capture(&tr, &sampler,
+                          start_time + (num_bits + search) * BIT_DURATION);
+
+            if (trace_out && trace_save(&tr, trace_out) == 0)
+                printf("receiver: trace written to %s\n", trace_out);
+            if (decode_trace(&tr, num_bits, &lt, search, received) != 0) return 1;
+            trace_free(&tr);
+        } else if (out) {
+            int rc = arq ? receive_arq(start_time, &lt, out, (size_t)chunk)
+                         : receive_framed(start_time, &lt, out);
+            if (arq) contention_pool_stop(&ack_pool);
+            stream_sampler_free(&sampler);
+            fclose(out);
+            free(received);
+            return rc ? 1 : 0;
+        } else if (pam4) {
+            if (receive_pam4(start_time, num_bits, alpha, received) != 0) {
+                stream_sampler_free(&sampler);
+                free(received);
+                return 1;
+            }
+        } else {
+            receive_live(start_time, num_bits, &lt, received);
+        }
+        stream_sampler_free(&sampler);
     }
     received[num_bits] = '\0';
 
+    if (!lt.fixed && !pam4)
+        printf("receiver: tracked levels idle = %.0f MB/s, hammered = %.0f MB/s, threshold = %.0f MB/s\n",
+               lt.level0, lt.level1, lt.threshold);
+
     printf("==========================================\n");
     printf("receiver: received bits -> \"%s\"\n", received);
     printf("==========================================\n");
 
     free(received);
     return 0;
-}
\ No newline at end of file
+}
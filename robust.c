@@ -0,0 +1,122 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include "robust.h"
+#include "timing.h"
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+long robust_switches(void)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_THREAD, &ru) != 0) return 0;
+    return ru.ru_nivcsw;
+}
+
+void robust_filter(double *x, const double *cost, const unsigned char *switched,
+                   int n, double cutoff, struct robust_window *w)
+{
+    double sorted[ROBUST_MAX_SAMPLES];
+    int    kept = 0, trim;
+
+    memset(w, 0, sizeof(*w));
+    if (n > ROBUST_MAX_SAMPLES) n = ROBUST_MAX_SAMPLES;
+    w->n = n;
+    if (n < 1) return;
+    if (!cost) {
+        memcpy(sorted, x, (size_t)n * sizeof(*x));
+        cost = sorted;
+    }
+
+    if (cutoff <= 0.0) {
+        double c[ROBUST_MAX_SAMPLES];
+
+        memcpy(c, cost, (size_t)n * sizeof(*c));
+        qsort(c, (size_t)n, sizeof(*c), cmp_double);
+        cutoff = ROBUST_GAP * c[(int)(ROBUST_PCT * (n - 1))];
+    }
+    w->cutoff = cutoff;
+
+    /* cost may alias sorted, so the kept values are compacted in x */
+    for (int i = 0; i < n; i++) {
+        if (switched && switched[i])  w->switched++;
+        else if (cost[i] > cutoff)    w->gaps++;
+        else                          x[kept++] = x[i];
+    }
+    w->kept = kept;
+    if (!kept) {
+        /* every sample was rejected: a disturbed value beats a forced decision */
+        w->fallback = 1;
+        qsort(x, (size_t)n, sizeof(*x), cmp_double);
+        w->median = w->trimmed = n % 2 ? x[n / 2] : 0.5 * (x[n / 2 - 1] + x[n / 2]);
+        return;
+    }
+
+    qsort(x, (size_t)kept, sizeof(*x), cmp_double);
+    w->median = kept % 2 ? x[kept / 2] : 0.5 * (x[kept / 2 - 1] + x[kept / 2]);
+
+    trim = (int)(ROBUST_TRIM * kept);
+    for (int i = trim; i < kept - trim; i++) w->trimmed += x[i];
+    w->trimmed /= kept - 2 * trim;
+}
+
+/*
+ * Involuntary switches summed over the OpenMP team that runs the passes;
+ * the team is persistent, so the same threads are counted every time.
+ */
+static long team_switches(void)
+{
+    long sum = 0;
+
+#pragma omp parallel reduction(+:sum)
+    sum += robust_switches();
+    return sum;
+}
+
+int robust_stream_run(struct stream_sampler *s, double until, double *bw, int max,
+                      struct robust_window *w)
+{
+    double        cost[ROBUST_MAX_SAMPLES];
+    unsigned char switched[ROBUST_MAX_SAMPLES];
+    int           count = 0;
+
+    if (max > ROBUST_MAX_SAMPLES) max = ROBUST_MAX_SAMPLES;
+    while (count < max) {
+        if (mysecond() + s->last_pass > until) break;
+
+        long   before = team_switches();
+        double rate   = stream_sampler_once(s);
+        if (rate <= 0.0) continue;
+
+        bw[count]       = rate;
+        cost[count]     = s->last_pass;
+        switched[count] = team_switches() != before;
+        count++;
+    }
+    robust_filter(bw, cost, switched, count, 0.0, w);
+    return w->fallback ? w->n : w->kept;
+}
+
+double robust_stream_window(struct stream_sampler *s, double until, double *bw, int max,
+                            struct robust_window *w)
+{
+    struct robust_window local;
+
+    if (!w) w = &local;
+    robust_stream_run(s, until, bw, max, w);
+    return w->trimmed;
+}
+
+void robust_print(const struct robust_window *w, const char *who, FILE *f)
+{
+    fprintf(f, "%s: kept %d of %d sample(s) (%d switched, %d gaps), %s %.0f, trimmed mean %.0f\n",
+            who, w->kept, w->n, w->switched, w->gaps,
+            w->fallback ? "all rejected, unfiltered median" : "median", w->median, w->trimmed);
+}
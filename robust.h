@@ -0,0 +1,78 @@
+#ifndef ROBUST_H
+#define ROBUST_H
+
+#include <stdio.h>
+#include "stream_sampler.h"
+
+/*
+ * Outlier-robust window statistics for the receivers.
+ *
+ * A plain window mean is only as good as its worst sample: a pass that
+ * was preempted, or a timed load that took an interrupt, reports a
+ * bandwidth or latency that says nothing about the channel, and one of
+ * them can move a whole window across the threshold.  robust_filter()
+ * drops such samples instead of averaging them in:
+ *
+ *  - samples during which a sampling thread was switched out
+ *    involuntarily (getrusage(RUSAGE_THREAD) ru_nivcsw before and after;
+ *    robust_stream_run() sums it over the whole OpenMP team, a caller
+ *    timing single loads tracks its own thread);
+ *  - samples whose cost (pass duration, load cycles) is above a cutoff,
+ *    by default ROBUST_GAP times the window's ROBUST_PCT percentile cost:
+ *    a TSC gap that no undisturbed sample of the window shows.
+ *
+ * The rest is summarised as its median and its mean with ROBUST_TRIM cut
+ * from each end, and struct robust_window says how many samples were
+ * rejected and why, so the receivers can print it per window.  A window
+ * in which every sample is rejected (a 1 ms window may hold a single
+ * pass) falls back to the unfiltered median rather than to nothing.  On an idle
+ * host nothing is rejected and the trimmed mean is the old window mean.
+ */
+#define ROBUST_GAP  3.0
+#define ROBUST_PCT  0.5
+#define ROBUST_TRIM 0.1        /* fraction cut from each end */
+#define ROBUST_MAX_SAMPLES 4096
+
+struct robust_window {
+    int    n;           /* samples taken */
+    int    kept;
+    int    switched;    /* rejected: involuntary context switch */
+    int    gaps;        /* rejected: cost above the cutoff */
+    double cutoff;      /* cost cutoff used */
+    int    fallback;    /* every sample rejected: the statistics cover all n */
+    double median;      /* of the kept samples; 0 only if n is 0 */
+    double trimmed;     /* trimmed mean of the kept samples, or the median on fallback */
+};
+
+/* Involuntary context switches of the calling thread so far. */
+long robust_switches(void);
+
+/*
+ * Filters and summarises x[0..n) (at most ROBUST_MAX_SAMPLES).  cost is
+ * the per-sample cost, or NULL to use x itself; switched (may be NULL)
+ * flags preempted samples; cutoff <= 0 picks the default above.  On
+ * return x[0..w->kept) holds the kept samples in ascending order, or on
+ * fallback x[0..n) holds all of them.
+ */
+void robust_filter(double *x, const double *cost, const unsigned char *switched,
+                   int n, double cutoff, struct robust_window *w);
+
+/*
+ * stream_sampler_run() with every pass checked for context switches and
+ * its duration used as the cost; the bandwidths that robust_filter()
+ * leaves in bw are returned sorted.  Returns their number.
+ */
+int  robust_stream_run(struct stream_sampler *s, double until, double *bw, int max,
+                       struct robust_window *w);
+/*
+ * One receiver window: robust_stream_run() and its trimmed mean, which is
+ * the unfiltered median if every pass was disturbed and 0.0 only if no
+ * pass fit before `until`.  w may be NULL.
+ */
+double robust_stream_window(struct stream_sampler *s, double until, double *bw, int max,
+                            struct robust_window *w);
+
+/* "kept/n (s switched, g gaps)" for a window report. */
+void robust_print(const struct robust_window *w, const char *who, FILE *f);
+
+#endif
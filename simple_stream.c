@@ -4,10 +4,26 @@
 # include <float.h>
 # include <limits.h>
 # include <sys/time.h>
+# include <stdlib.h>
+# include <string.h>
+# include "topology.h"
+# include "hugemem.h"
+# include "kernels.h"
+# include "stream_dump.h"
 
 /*-----------------------------------------------------------------------
  * INSTRUCTIONS:
- *  gcc -DSTREAM_ARRAY_SIZE=10000000 -fopenmp -O3 simple_stream.c -o simple_stream
+ *  gcc -DSTREAM_ARRAY_SIZE=10000000 -fopenmp -O3 simple_stream.c topology.c hugemem.c \
+ *      kernels.c stream_dump.c timing.c -o simple_stream
+ *  ./simple_stream [--cpus 0-9] [--node 0] [--pages huge|thp|small]
+ *      [--kernel auto|scalar|avx2|avx512|nt|read|list]
+ *      [--op copy,scale,add,triad|all] [--dump FILE|- [--dump-format csv|bin]]
+ *      [--size N | --period SECONDS] [--ntimes N]
+ *  --size sets the elements per array at runtime (STREAM_ARRAY_SIZE is the
+ *  default); --period sizes the arrays from the LLC and the measured kernel
+ *  bandwidth so one Copy pass takes about that long.
+ *  --kernel applies to Copy; --dump writes every iteration (see stream_dump.h),
+ *  and stream_delta compares an idle and a contended dump per op.
  *  export OMP_NUM_THREADS=10
  *	1) STREAM requires different amounts of memory to run on different
  *           systems, depending on both the system cache size(s) and the
@@ -130,9 +146,9 @@
 #define STREAM_TYPE double
 #endif
 
-static STREAM_TYPE	a[STREAM_ARRAY_SIZE+OFFSET],
-			b[STREAM_ARRAY_SIZE+OFFSET],
-			c[STREAM_ARRAY_SIZE+OFFSET];
+/* huge-page backed and pre-faulted, see hugemem.h */
+static STREAM_TYPE	*a, *b, *c;
+static struct hugemem	ma, mb, mc;
 
 static double	avgtime[4] = {0}, maxtime[4] = {0},
 		mintime[4] = {FLT_MAX,FLT_MAX,FLT_MAX,FLT_MAX};
@@ -140,27 +156,100 @@ static double	avgtime[4] = {0}, maxtime[4] = {0},
 static char	*label[4] = {"Copy:      ", "Scale:     ",
     "Add:       ", "Triad:     "};
 
-static double	bytes[4] = {
-    2 * sizeof(STREAM_TYPE) * STREAM_ARRAY_SIZE,
-    2 * sizeof(STREAM_TYPE) * STREAM_ARRAY_SIZE,
-    3 * sizeof(STREAM_TYPE) * STREAM_ARRAY_SIZE,
-    3 * sizeof(STREAM_TYPE) * STREAM_ARRAY_SIZE
-    };
+/* STREAM_ARRAY_SIZE and NTIMES are only defaults; see --size, --ntimes, --period */
+static ssize_t	array_size = STREAM_ARRAY_SIZE;
+static int	ntimes = NTIMES;
+
+static double	bytes[4];
+
+/* --period: size used when the LLC is unknown, and kernel passes measured */
+#define AUTOSIZE_MIN	(1 << 16)
+#define AUTOSIZE_PROBES	3
+
+/* (re)allocates a[], b[], c[] with array_size elements and initializes them */
+static void
+alloc_arrays(int pages, int node)
+    {
+    ssize_t	j;
+    size_t	len = sizeof(STREAM_TYPE) * (array_size+OFFSET);
+
+    hugemem_free(&ma);
+    hugemem_free(&mb);
+    hugemem_free(&mc);
+    if (hugemem_alloc(&ma, len, pages, node) != 0 ||
+	hugemem_alloc(&mb, len, pages, node) != 0 ||
+	hugemem_alloc(&mc, len, pages, node) != 0)
+	exit(1);
+    a = ma.p;
+    b = mb.p;
+    c = mc.p;
+
+#pragma omp parallel for
+    for (j=0; j<array_size; j++) {
+	    a[j] = 1.0;
+	    b[j] = 2.0;
+	    c[j] = 0.0;
+	}
+    }
+
+/* one timed STREAM operation; Copy goes through the selected kernel */
+static void
+run_op(int op, const struct mem_kernel *kernel, STREAM_TYPE scalar)
+    {
+    ssize_t	j;
+
+    switch (op) {
+    case STREAM_COPY:
+	kernel_run(kernel, c, a, array_size);
+	break;
+    case STREAM_SCALE:
+#pragma omp parallel for
+	for (j=0; j<array_size; j++)
+	    b[j] = scalar*c[j];
+	break;
+    case STREAM_ADD:
+#pragma omp parallel for
+	for (j=0; j<array_size; j++)
+	    c[j] = a[j]+b[j];
+	break;
+    case STREAM_TRIAD:
+#pragma omp parallel for
+	for (j=0; j<array_size; j++)
+	    a[j] = b[j]+scalar*c[j];
+	break;
+    }
+    }
+
+static double	*times[4], *starts[4];
+static struct stream_record	*records;
 
 extern double mysecond();
 extern void checkSTREAMresults();
 #ifdef _OPENMP
 extern int omp_get_num_threads();
+extern int omp_get_thread_num();
 #endif
 int
-main()
+main(int argc, char *argv[])
     {
+    const char		*cpus = NULL;
+    int			node = -1;
+    int			pages = HUGEMEM_HUGETLB;
+    const char		*kname = NULL;
+    const struct mem_kernel	*kernel;
+    int			ops = 1 << STREAM_COPY;
+    const char		*dump = NULL;
+    long		size = 0;
+    double		period = 0.0;
+    int			dump_format = DUMP_CSV;
+    size_t		nrec = 0;
+    struct placement	pl;
     int			quantum, checktick();
     int			BytesPerWord;
     int			k;
     ssize_t		j;
     STREAM_TYPE		scalar;
-    double		t, times[4][NTIMES];
+    double		t;
 
     /* --- SETUP --- determine precision and check timing --- */
 
@@ -204,13 +293,94 @@ main()
     // printf ("Number of Threads counted = %i\n",k);
 #endif
 
-    /* Get initial value for system clock. */
-#pragma omp parallel for
-    for (j=0; j<STREAM_ARRAY_SIZE; j++) {
-	    a[j] = 1.0;
-	    b[j] = 2.0;
-	    c[j] = 0.0;
+    for (k = 1; k < argc; k++) {
+	if      (strcmp(argv[k], "--cpus") == 0 && k+1 < argc) cpus = argv[++k];
+	else if (strcmp(argv[k], "--node") == 0 && k+1 < argc) node = atoi(argv[++k]);
+	else if (strcmp(argv[k], "--pages") == 0 && k+1 < argc) pages = hugemem_parse_kind(argv[++k]);
+	else if (strcmp(argv[k], "--kernel") == 0 && k+1 < argc) kname = argv[++k];
+	else if (strcmp(argv[k], "--op") == 0 && k+1 < argc) ops = stream_parse_ops(argv[++k]);
+	else if (strcmp(argv[k], "--dump") == 0 && k+1 < argc) dump = argv[++k];
+	else if (strcmp(argv[k], "--dump-format") == 0 && k+1 < argc) dump_format = stream_dump_parse_format(argv[++k]);
+	else if (strcmp(argv[k], "--size") == 0 && k+1 < argc) size = atol(argv[++k]);
+	else if (strcmp(argv[k], "--ntimes") == 0 && k+1 < argc) ntimes = atoi(argv[++k]);
+	else if (strcmp(argv[k], "--period") == 0 && k+1 < argc) period = atof(argv[++k]);
+    }
+    if (ops <= 0 || dump_format < 0) {
+	fprintf(stderr, "simple_stream: bad --op or --dump-format\n");
+	exit(1);
+    }
+    if (ntimes < 2 || size < 0 || period < 0.0) {
+	fprintf(stderr, "simple_stream: need --ntimes >= 2, --size >= 1, --period > 0\n");
+	exit(1);
+    }
+    if (size > 0) {
+	array_size = size;
+	period = 0.0;
+    }
+    if (kname && strcmp(kname, "list") == 0) {
+	kernel_list(stdout);
+	exit(0);
+    }
+    if (!(kernel = kernel_select(kname))) exit(1);
+    if (kernel->arrays == 1) label[0] = "Read:      ";
+    printf("simple_stream: kernel = %s\n", kernel->name);
+    if (pages < 0) {
+	fprintf(stderr, "simple_stream: --pages must be huge, thp or small\n");
+	exit(1);
+    }
+    if (placement_init(&pl, cpus, node) != 0) exit(1);
+    if (cpus || node >= 0) placement_print(&pl, "simple_stream", stdout);
+
+    /* pin the OpenMP threads for good */
+#ifdef _OPENMP
+#pragma omp parallel
+    topology_pin_self(placement_cpu(&pl, omp_get_thread_num()));
+#else
+    topology_pin_self(placement_cpu(&pl, 0));
+#endif
+
+    /*
+     * --period: start at the LLC floor, measure the kernel there and grow
+     * the arrays until one Copy pass takes about `period` seconds.
+     */
+    if (period > 0.0) {
+	size_t llc = topology_llc_bytes();
+	double best = 0.0;
+
+	array_size = kernel_autosize(kernel, 0.0, 0.0, llc);
+	if (array_size < AUTOSIZE_MIN) array_size = AUTOSIZE_MIN;
+	alloc_arrays(pages, node);
+	for (k=0; k<AUTOSIZE_PROBES; k++) {
+	    t = mysecond();
+	    kernel_run(kernel, c, a, array_size);
+	    t = mysecond() - t;
+	    if (t > 0.0) best = MAX(best, 1.0E-06 * kernel->arrays * sizeof(STREAM_TYPE) * array_size / t);
 	}
+	size = kernel_autosize(kernel, period, best, llc);
+	printf("simple_stream: LLC %.1f MiB, %.0f MB/s at the floor -> %ld elements for %.3f ms\n",
+	       llc / (1024.0*1024.0), best, size > array_size ? size : (long)array_size, 1e3 * period);
+	if (size > array_size) {
+	    array_size = size;
+	    alloc_arrays(pages, node);
+	}
+    } else {
+	alloc_arrays(pages, node);
+    }
+    hugemem_print(&ma, "simple_stream: a[]", stdout);
+
+    bytes[0] = kernel->arrays * sizeof(STREAM_TYPE) * array_size;
+    bytes[1] = 2 * sizeof(STREAM_TYPE) * array_size;
+    bytes[2] = 3 * sizeof(STREAM_TYPE) * array_size;
+    bytes[3] = 3 * sizeof(STREAM_TYPE) * array_size;
+    for (j=0; j<4; j++) {
+	times[j]  = calloc(ntimes, sizeof(double));
+	starts[j] = calloc(ntimes, sizeof(double));
+	if (!times[j] || !starts[j]) { perror("simple_stream: calloc"); exit(1); }
+    }
+    if (!(records = calloc(4 * (size_t)ntimes, sizeof(*records)))) {
+	perror("simple_stream: calloc");
+	exit(1);
+    }
 
     // printf(HLINE);
 
@@ -225,7 +395,7 @@ main()
 
     t = mysecond();
 #pragma omp parallel for
-    for (j = 0; j < STREAM_ARRAY_SIZE; j++)
+    for (j = 0; j < array_size; j++)
 		a[j] = 2.0E0 * a[j];
     t = 1.0E6 * (mysecond() - t);
 
@@ -245,23 +415,22 @@ main()
     /*	--- MAIN LOOP --- repeat test cases NTIMES times --- */
 
     scalar = 3.0;
-    for (k=0; k<NTIMES; k++)
-    {
-        times[0][k] = mysecond();
-
-#pragma omp parallel for
-        for (j=0; j<STREAM_ARRAY_SIZE; j++)
-            c[j] = a[j];
-
-        times[0][k] = mysecond() - times[0][k];
-	}
+    for (k=0; k<ntimes; k++)
+	for (j=0; j<4; j++)
+	    {
+	    if (!(ops & (1 << j))) continue;
+	    starts[j][k] = mysecond();
+	    run_op(j, kernel, scalar);
+	    times[j][k] = mysecond() - starts[j][k];
+	    }
 
     /*	--- SUMMARY --- */
 
-    for (k=1; k<NTIMES; k++) /* note -- skip first iteration */
+    for (k=1; k<ntimes; k++) /* note -- skip first iteration */
 	{
-	for (j=0; j<1; j++)
+	for (j=0; j<4; j++)
 	    {
+	    if (!(ops & (1 << j))) continue;
 	    avgtime[j] = avgtime[j] + times[j][k];
 	    mintime[j] = MIN(mintime[j], times[j][k]);
 	    maxtime[j] = MAX(maxtime[j], times[j][k]);
@@ -269,8 +438,9 @@ main()
 	}
     
     printf("Function    Best Rate MB/s  Avg time     Min time     Max time\n");
-    for (j=0; j<1; j++) {
-		avgtime[j] = avgtime[j]/(double)(NTIMES-1);
+    for (j=0; j<4; j++) {
+		if (!(ops & (1 << j))) continue;
+		avgtime[j] = avgtime[j]/(double)(ntimes-1);
 
 		printf("%s%12.1f  %11.6f  %11.6f  %11.6f\n", label[j],
 	       1.0E-06 * bytes[j]/mintime[j],
@@ -284,6 +454,29 @@ main()
     /*checkSTREAMresults();*/
     // printf(HLINE);
 
+    /* every iteration, including the first, in time order */
+    if (dump) {
+	for (k=0; k<ntimes; k++)
+	    for (j=0; j<4; j++) {
+		if (!(ops & (1 << j))) continue;
+		records[nrec].iter    = k;
+		records[nrec].op      = j;
+		records[nrec].start   = starts[j][k];
+		records[nrec].seconds = times[j][k];
+		records[nrec].mbps    = times[j][k] > 0.0 ? 1.0E-06 * bytes[j]/times[j][k] : 0.0;
+		nrec++;
+	    }
+	if (stream_dump_save(dump, dump_format, records, nrec) != 0) exit(1);
+    }
+
+    hugemem_free(&ma);
+    hugemem_free(&mb);
+    hugemem_free(&mc);
+    for (j=0; j<4; j++) {
+	free(times[j]);
+	free(starts[j]);
+    }
+    free(records);
     return 0;
 }
 
@@ -321,20 +514,7 @@ checktick()
 
 
 
-/* A gettimeofday routine to give access to the wall
-   clock timer on most UNIX-like systems.  */
-
-#include <sys/time.h>
-
-double mysecond()
-{
-        struct timeval tp;
-        struct timezone tzp;
-        int i;
-
-        i = gettimeofday(&tp,&tzp);
-        return ( (double) tp.tv_sec + (double) tp.tv_usec * 1.e-6 );
-}
+/* mysecond() comes from timing.c (CLOCK_MONOTONIC_RAW). */
 
 #ifndef abs
 #define abs(a) ((a) >= 0 ? (a) : -(a))
@@ -356,7 +536,7 @@ void checkSTREAMresults ()
 	aj = 2.0E0 * aj;
     /* now execute timing loop */
 	scalar = 3.0;
-	for (k=0; k<NTIMES; k++)
+	for (k=0; k<ntimes; k++)
         {
             cj = aj;
             bj = scalar*cj;
@@ -368,15 +548,15 @@ void checkSTREAMresults ()
 	aSumErr = 0.0;
 	bSumErr = 0.0;
 	cSumErr = 0.0;
-	for (j=0; j<STREAM_ARRAY_SIZE; j++) {
+	for (j=0; j<array_size; j++) {
 		aSumErr += abs(a[j] - aj);
 		bSumErr += abs(b[j] - bj);
 		cSumErr += abs(c[j] - cj);
 		// if (j == 417) printf("Index 417: c[j]: %f, cj: %f\n",c[j],cj);	// MCCALPIN
 	}
-	aAvgErr = aSumErr / (STREAM_TYPE) STREAM_ARRAY_SIZE;
-	bAvgErr = bSumErr / (STREAM_TYPE) STREAM_ARRAY_SIZE;
-	cAvgErr = cSumErr / (STREAM_TYPE) STREAM_ARRAY_SIZE;
+	aAvgErr = aSumErr / (STREAM_TYPE) array_size;
+	bAvgErr = bSumErr / (STREAM_TYPE) array_size;
+	cAvgErr = cSumErr / (STREAM_TYPE) array_size;
 
 	if (sizeof(STREAM_TYPE) == 4) {
 		epsilon = 1.e-6;
@@ -395,7 +575,7 @@ void checkSTREAMresults ()
 		printf ("Failed Validation on array a[], AvgRelAbsErr > epsilon (%e)\n",epsilon);
 		printf ("     Expected Value: %e, AvgAbsErr: %e, AvgRelAbsErr: %e\n",aj,aAvgErr,abs(aAvgErr)/aj);
 		ierr = 0;
-		for (j=0; j<STREAM_ARRAY_SIZE; j++) {
+		for (j=0; j<array_size; j++) {
 			if (abs(a[j]/aj-1.0) > epsilon) {
 				ierr++;
 #ifdef VERBOSE
@@ -414,7 +594,7 @@ void checkSTREAMresults ()
 		printf ("     Expected Value: %e, AvgAbsErr: %e, AvgRelAbsErr: %e\n",bj,bAvgErr,abs(bAvgErr)/bj);
 		printf ("     AvgRelAbsErr > Epsilon (%e)\n",epsilon);
 		ierr = 0;
-		for (j=0; j<STREAM_ARRAY_SIZE; j++) {
+		for (j=0; j<array_size; j++) {
 			if (abs(b[j]/bj-1.0) > epsilon) {
 				ierr++;
 #ifdef VERBOSE
@@ -433,7 +613,7 @@ void checkSTREAMresults ()
 		printf ("     Expected Value: %e, AvgAbsErr: %e, AvgRelAbsErr: %e\n",cj,cAvgErr,abs(cAvgErr)/cj);
 		printf ("     AvgRelAbsErr > Epsilon (%e)\n",epsilon);
 		ierr = 0;
-		for (j=0; j<STREAM_ARRAY_SIZE; j++) {
+		for (j=0; j<array_size; j++) {
 			if (abs(c[j]/cj-1.0) > epsilon) {
 				ierr++;
 #ifdef VERBOSE
@@ -0,0 +1,67 @@
+#include <math.h>
+#include "stats.h"
+
+/* t(0.975, df) for df = 1..30; beyond that the normal value is close enough */
+static const double t95[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+double stats_t95(int df)
+{
+    if (df < 1) return NAN;
+    if (df <= 30) return t95[df - 1];
+    return 1.960 + 2.4 / df;
+}
+
+void stats_summarize(const double *x, int n, struct summary *s)
+{
+    double m = 0.0, v = 0.0;
+
+    s->n = n;
+    if (n < 1) {
+        s->mean = s->sd = s->ci = NAN;
+        return;
+    }
+    for (int i = 0; i < n; i++) m += x[i];
+    m /= n;
+    for (int i = 0; i < n; i++) v += (x[i] - m) * (x[i] - m);
+
+    s->mean = m;
+    s->sd   = n > 1 ? sqrt(v / (n - 1)) : 0.0;
+    s->ci   = n > 1 ? stats_t95(n - 1) * s->sd / sqrt(n) : NAN;
+}
+
+double stats_binary_entropy(double p)
+{
+    if (p <= 0.0 || p >= 1.0) return 0.0;
+    return -p * log2(p) - (1.0 - p) * log2(1.0 - p);
+}
+
+double stats_bsc_capacity(double p)
+{
+    return 1.0 - stats_binary_entropy(p);
+}
+
+/* mutual information with P(X = 1) = q */
+static double bac_information(double q, double p01, double p10)
+{
+    double y1 = (1.0 - q) * p01 + q * (1.0 - p10);
+    return stats_binary_entropy(y1) - (1.0 - q) * stats_binary_entropy(p01)
+                                    - q * stats_binary_entropy(p10);
+}
+
+double stats_bac_capacity(double p01, double p10)
+{
+    double lo = 0.0, hi = 1.0;
+
+    /* I(q) is concave: ternary search */
+    for (int i = 0; i < 100; i++) {
+        double a = lo + (hi - lo) / 3.0, b = hi - (hi - lo) / 3.0;
+        if (bac_information(a, p01, p10) < bac_information(b, p01, p10)) lo = a;
+        else                                                             hi = b;
+    }
+    double c = bac_information(0.5 * (lo + hi), p01, p10);
+    return c > 0.0 ? c : 0.0;
+}
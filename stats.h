@@ -0,0 +1,33 @@
+#ifndef STATS_H
+#define STATS_H
+
+/*
+ * Small statistics helpers for the measurement tools.
+ *
+ * stats_summarize() gives the sample mean, standard deviation and the
+ * half-width of a two-sided 95% Student-t confidence interval for the
+ * mean, so a point measured N times is reported as mean +- ci.  With a
+ * single run the interval is undefined and ci is NaN.
+ */
+struct summary {
+    int    n;
+    double mean;
+    double sd;      /* sample standard deviation (n - 1) */
+    double ci;      /* 95% confidence half-width of the mean */
+};
+
+void   stats_summarize(const double *x, int n, struct summary *s);
+/* Two-sided 95% critical value of Student's t with `df` degrees of freedom. */
+double stats_t95(int df);
+
+/* H(p) in bits; 0 at p = 0 and p = 1. */
+double stats_binary_entropy(double p);
+/* Capacity of a binary symmetric channel with crossover p, bits per use. */
+double stats_bsc_capacity(double p);
+/*
+ * Capacity of a binary asymmetric channel, P(1|0) = p01 and P(0|1) = p10,
+ * maximized over the input distribution; bits per use.
+ */
+double stats_bac_capacity(double p01, double p10);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Ranks the STREAM ops by how well they see memory contention.
+ *
+ * Takes two dumps from simple_stream --dump (stream_dump.h) with the same
+ * --op list, one from an idle host and one taken while a transmitter
+ * hammers memory, and prints per op the bandwidth under both, the drop
+ * and the SNR of the two distributions,
+ *
+ *     (mu_idle - mu_busy)^2 / (var_idle + var_busy)
+ *
+ * as placement_sweep reports it per placement, best op first.  Iteration 0
+ * is a warm-up and is skipped, as in simple_stream's own summary.
+ *
+ *  gcc -O2 stream_delta.c stream_dump.c stats.c -o stream_delta -lm
+ *  ./simple_stream --op all --dump idle.bin --dump-format bin
+ *  ./simple_stream --op all --dump busy.bin --dump-format bin    (transmitter running)
+ *  ./stream_delta idle.bin busy.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "stream_dump.h"
+#include "stats.h"
+
+struct op_delta {
+    int            op;
+    struct summary idle, busy;
+    double         snr;
+};
+
+/* mbps of one op's records, iteration 0 skipped; returns the count. */
+static int op_samples(const struct stream_record *r, size_t n, int op, double *x)
+{
+    int k = 0;
+
+    for (size_t i = 0; i < n; i++)
+        if ((int)r[i].op == op && r[i].iter > 0 && r[i].mbps > 0.0) x[k++] = r[i].mbps;
+    return k;
+}
+
+static int by_snr(const void *a, const void *b)
+{
+    double x = ((const struct op_delta *)a)->snr, y = ((const struct op_delta *)b)->snr;
+    return (x < y) - (x > y);
+}
+
+int main(int argc, char *argv[])
+{
+    struct stream_record *idle = NULL, *busy = NULL;
+    size_t                nidle, nbusy;
+    struct op_delta       d[STREAM_NOPS];
+    int                   nd = 0;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s IDLE_DUMP BUSY_DUMP\n", argv[0]);
+        return 1;
+    }
+    if (stream_dump_load(argv[1], &idle, &nidle) != 0 ||
+        stream_dump_load(argv[2], &busy, &nbusy) != 0) {
+        free(idle);
+        return 1;
+    }
+
+    double *x = malloc((nidle > nbusy ? nidle : nbusy) * sizeof(*x) + sizeof(*x));
+    if (!x) { perror("stream_delta: malloc"); free(idle); free(busy); return 1; }
+
+    for (int op = 0; op < STREAM_NOPS; op++) {
+        struct op_delta *o = &d[nd];
+
+        o->op = op;
+        stats_summarize(x, op_samples(idle, nidle, op, x), &o->idle);
+        stats_summarize(x, op_samples(busy, nbusy, op, x), &o->busy);
+        if (o->idle.n < 2 || o->busy.n < 2) continue;
+
+        double diff = o->idle.mean - o->busy.mean;
+        double var  = o->idle.sd * o->idle.sd + o->busy.sd * o->busy.sd;
+        o->snr = var > 0.0 ? diff * diff / var : INFINITY;
+        nd++;
+    }
+    if (!nd) {
+        fprintf(stderr, "stream_delta: no op has two or more iterations in both dumps\n");
+        free(x); free(idle); free(busy);
+        return 1;
+    }
+    qsort(d, (size_t)nd, sizeof(*d), by_snr);
+
+    printf("%-6s %10s %10s %10s %10s %7s  %8s %7s\n",
+           "op", "idle MB/s", "sd", "busy MB/s", "sd", "drop", "SNR", "dB");
+    for (int i = 0; i < nd; i++)
+        printf("%-6s %10.0f %10.0f %10.0f %10.0f %6.1f%%  %8.2f %7.1f\n",
+               stream_op_names[d[i].op], d[i].idle.mean, d[i].idle.sd,
+               d[i].busy.mean, d[i].busy.sd,
+               100.0 * (d[i].idle.mean - d[i].busy.mean) / d[i].idle.mean,
+               d[i].snr, 10.0 * log10(d[i].snr));
+    printf("stream_delta: %s separates idle and busy best\n", stream_op_names[d[0].op]);
+
+    free(x);
+    free(idle);
+    free(busy);
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream_dump.h"
+
+/* on-disk record: two uint32 and three doubles */
+#define DUMP_RECORD_BYTES (2 * sizeof(uint32_t) + 3 * sizeof(double))
+
+const char *const stream_op_names[STREAM_NOPS] = { "copy", "scale", "add", "triad" };
+
+static int op_index(const char *name, size_t len)
+{
+    for (int i = 0; i < STREAM_NOPS; i++)
+        if (strlen(stream_op_names[i]) == len && strncmp(stream_op_names[i], name, len) == 0)
+            return i;
+    return -1;
+}
+
+int stream_parse_ops(const char *list)
+{
+    int mask = 0;
+
+    if (strcmp(list, "all") == 0) return (1 << STREAM_NOPS) - 1;
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        int    op  = op_index(list, len);
+        if (op < 0) {
+            fprintf(stderr, "stream_dump: unknown op '%.*s'\n", (int)len, list);
+            return -1;
+        }
+        mask |= 1 << op;
+        list += len;
+        if (*list == ',') list++;
+    }
+    return mask;
+}
+
+int stream_dump_parse_format(const char *s)
+{
+    if (strcmp(s, "csv") == 0) return DUMP_CSV;
+    if (strcmp(s, "bin") == 0 || strcmp(s, "binary") == 0) return DUMP_BINARY;
+    return -1;
+}
+
+int stream_dump_save(const char *path, int format,
+                     const struct stream_record *r, size_t n)
+{
+    int   to_stdout = strcmp(path, "-") == 0;
+    FILE *f = to_stdout ? stdout : fopen(path, format == DUMP_BINARY ? "wb" : "w");
+
+    if (!f) { perror(path); return -1; }
+    if (format == DUMP_BINARY) {
+        uint64_t magic = STREAM_DUMP_MAGIC, count = n;
+        fwrite(&magic, sizeof(magic), 1, f);
+        fwrite(&count, sizeof(count), 1, f);
+        for (size_t i = 0; i < n; i++) {
+            double v[3] = { r[i].start, r[i].seconds, r[i].mbps };
+            fwrite(&r[i].iter, sizeof(uint32_t), 1, f);
+            fwrite(&r[i].op, sizeof(uint32_t), 1, f);
+            fwrite(v, sizeof(double), 3, f);
+        }
+    } else {
+        fprintf(f, "iter,op,start,seconds,mbps\n");
+        for (size_t i = 0; i < n; i++)
+            fprintf(f, "%u,%s,%.9f,%.9f,%.1f\n", r[i].iter,
+                    stream_op_names[r[i].op % STREAM_NOPS],
+                    r[i].start, r[i].seconds, r[i].mbps);
+    }
+    if (to_stdout) return fflush(f) == 0 ? 0 : -1;
+    if (fclose(f) != 0) { perror(path); return -1; }
+    return 0;
+}
+
+static int load_binary(FILE *f, const char *path, struct stream_record **r, size_t *n)
+{
+    uint64_t count;
+
+    if (fread(&count, sizeof(count), 1, f) != 1) {
+        fprintf(stderr, "%s: truncated header\n", path);
+        return -1;
+    }
+    /* never trust the header further than the file goes */
+    long here = ftell(f);
+    if (here >= 0 && fseek(f, 0, SEEK_END) == 0) {
+        long     end = ftell(f);
+        uint64_t fit = end > here ? (uint64_t)(end - here) / DUMP_RECORD_BYTES : 0;
+        if (count > fit) {
+            fprintf(stderr, "%s: header claims %llu records, the file holds %llu\n",
+                    path, (unsigned long long)count, (unsigned long long)fit);
+            count = fit;
+        }
+        fseek(f, here, SEEK_SET);
+    }
+    *r = calloc(count ? count : 1, sizeof(**r));
+    if (!*r) { perror("stream_dump: calloc"); return -1; }
+    for (*n = 0; *n < count; (*n)++) {
+        struct stream_record *x = &(*r)[*n];
+        double v[3];
+        if (fread(&x->iter, sizeof(uint32_t), 1, f) != 1 ||
+            fread(&x->op, sizeof(uint32_t), 1, f) != 1 ||
+            fread(v, sizeof(double), 3, f) != 3) {
+            fprintf(stderr, "%s: truncated after %zu records\n", path, *n);
+            break;
+        }
+        x->start   = v[0];
+        x->seconds = v[1];
+        x->mbps    = v[2];
+    }
+    return 0;
+}
+
+static int load_csv(FILE *f, const char *path, struct stream_record **r, size_t *n)
+{
+    char   line[256], op[16];
+    size_t cap = 256;
+
+    *n = 0;
+    *r = malloc(cap * sizeof(**r));
+    if (!*r) { perror("stream_dump: malloc"); return -1; }
+    if (!fgets(line, sizeof(line), f) || strncmp(line, "iter,", 5) != 0) {
+        fprintf(stderr, "%s: not a stream dump\n", path);
+        free(*r);
+        *r = NULL;
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        struct stream_record x;
+        if (sscanf(line, "%u,%15[^,],%lf,%lf,%lf", &x.iter, op,
+                   &x.start, &x.seconds, &x.mbps) != 5)
+            continue;
+        int o = op_index(op, strlen(op));
+        if (o < 0) continue;
+        x.op = (uint32_t)o;
+        if (*n == cap) {
+            struct stream_record *grown = realloc(*r, 2 * cap * sizeof(**r));
+            if (!grown) { perror("stream_dump: realloc"); break; }
+            *r  = grown;
+            cap *= 2;
+        }
+        (*r)[(*n)++] = x;
+    }
+    return 0;
+}
+
+int stream_dump_load(const char *path, struct stream_record **r, size_t *n)
+{
+    FILE    *f = fopen(path, "rb");
+    uint64_t magic = 0;
+    int      rc;
+
+    *r = NULL;
+    *n = 0;
+    if (!f) { perror(path); return -1; }
+    if (fread(&magic, sizeof(magic), 1, f) == 1 && magic == STREAM_DUMP_MAGIC) {
+        rc = load_binary(f, path, r, n);
+    } else {
+        rewind(f);
+        rc = load_csv(f, path, r, n);
+    }
+    fclose(f);
+    return rc;
+}
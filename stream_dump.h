@@ -0,0 +1,50 @@
+#ifndef STREAM_DUMP_H
+#define STREAM_DUMP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Per-iteration STREAM timings, for tools that want the whole distribution
+ * rather than simple_stream's best/avg/max summary.
+ *
+ * CSV:    iter,op,start,seconds,mbps   (one header line)
+ * binary: uint64 magic "CWSTREAM", uint64 record count, then per record
+ *         uint32 iter, uint32 op, double start, double seconds, double mbps
+ *         in host byte order.
+ *
+ * `op` indexes stream_op_names; `start` is on the mysecond() time base.
+ * stream_delta.c loads an idle and a contended dump and ranks the ops.
+ */
+#define STREAM_DUMP_MAGIC 0x4d41455254535743ULL    /* "CWSTREAM" */
+
+enum stream_op { STREAM_COPY, STREAM_SCALE, STREAM_ADD, STREAM_TRIAD, STREAM_NOPS };
+
+extern const char *const stream_op_names[STREAM_NOPS];
+
+enum stream_dump_format { DUMP_CSV, DUMP_BINARY };
+
+struct stream_record {
+    uint32_t iter;
+    uint32_t op;
+    double   start;
+    double   seconds;
+    double   mbps;
+};
+
+/* "copy,add" or "all" -> bit mask of 1 << op; -1 on an unknown name. */
+int  stream_parse_ops(const char *list);
+/* "csv" / "bin" -> format; -1 if unknown. */
+int  stream_dump_parse_format(const char *s);
+
+/* path "-" writes to stdout. */
+int  stream_dump_save(const char *path, int format,
+                      const struct stream_record *r, size_t n);
+/*
+ * Reads either format; *r is malloc()ed and owned by the caller.  A binary
+ * header count beyond what the file holds is cut to the file.
+ */
+int  stream_dump_load(const char *path, struct stream_record **r, size_t *n);
+
+#endif
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "stream_sampler.h"
+#include "timing.h"
+#include "topology.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* used when the LLC size is unknown */
+#define AUTOSIZE_MIN    (1 << 16)
+#define AUTOSIZE_PROBES 5
+
+static int thread_index(void)
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+int stream_sampler_init(struct stream_sampler *s, size_t n,
+                        const struct placement *pl)
+{
+    ssize_t j;
+    size_t  len  = n * sizeof(double);
+    int     node = pl ? pl->node : -1;
+
+    memset(s, 0, sizeof(*s));
+    if (hugemem_alloc(&s->ma, len, HUGEMEM_HUGETLB, node) != 0 ||
+        hugemem_alloc(&s->mc, len, HUGEMEM_HUGETLB, node) != 0) {
+        stream_sampler_free(s);
+        return -1;
+    }
+    s->a     = s->ma.p;
+    s->c     = s->mc.p;
+    s->n     = n;
+
+    /*
+     * One thread per CPU of the placement, so no two sampler threads share
+     * a CPU; OpenMP reuses its threads, so pinning them once sticks.
+     */
+    if (pl && pl->ncpus) {
+#ifdef _OPENMP
+        omp_set_num_threads(pl->ncpus);
+#endif
+#pragma omp parallel
+        topology_pin_self(placement_cpu(pl, thread_index()));
+    }
+
+#pragma omp parallel for
+    for (j = 0; j < (ssize_t)n; j++) {
+        s->a[j] = 1.0;
+        s->c[j] = 0.0;
+    }
+
+    stream_sampler_set_kernel(s, kernel_select(NULL));
+    return 0;
+}
+
+int stream_sampler_init_period(struct stream_sampler *s, double period,
+                               const struct placement *pl,
+                               const struct mem_kernel *k)
+{
+    size_t llc  = topology_llc_bytes();
+    size_t n    = kernel_autosize(k, 0.0, 0.0, llc);
+    double best = 0.0;
+
+    if (n < AUTOSIZE_MIN) n = AUTOSIZE_MIN;
+    if (stream_sampler_init(s, n, pl) != 0) return -1;
+    stream_sampler_set_kernel(s, k);
+
+    for (int i = 0; i < AUTOSIZE_PROBES; i++) {
+        double rate = stream_sampler_once(s);
+        if (rate > best) best = rate;
+    }
+    n = kernel_autosize(k, period, best, llc);
+    if (n <= s->n) return 0;
+
+    stream_sampler_free(s);
+    if (stream_sampler_init(s, n, pl) != 0) return -1;
+    stream_sampler_set_kernel(s, k);
+    return 0;
+}
+
+void stream_sampler_free(struct stream_sampler *s)
+{
+    hugemem_free(&s->ma);
+    hugemem_free(&s->mc);
+    s->a = s->c = NULL;
+    s->n = 0;
+}
+
+void stream_sampler_set_kernel(struct stream_sampler *s, const struct mem_kernel *k)
+{
+    s->kernel = k;
+    s->bytes  = (double)k->arrays * sizeof(double) * s->n;
+
+    /* warm-up pass so the first real sample is not an outlier */
+    stream_sampler_once(s);
+}
+
+double stream_sampler_once(struct stream_sampler *s)
+{
+    double t;
+
+    t = mysecond();
+    kernel_run(s->kernel, s->c, s->a, s->n);
+    t = mysecond() - t;
+
+    s->last_pass = t;
+    if (t <= 0.0) return 0.0;
+    return 1.0E-06 * s->bytes / t;
+}
+
+int stream_sampler_run(struct stream_sampler *s, double until,
+                       double *bw, double *ts, int max)
+{
+    int count = 0;
+
+    while (count < max) {
+        double start = mysecond();
+        if (start + s->last_pass > until) break;
+
+        double rate = stream_sampler_once(s);
+        if (rate <= 0.0) continue;
+
+        bw[count] = rate;
+        if (ts) ts[count] = start + 0.5 * s->last_pass;
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,61 @@
+#ifndef STREAM_SAMPLER_H
+#define STREAM_SAMPLER_H
+
+#include <stddef.h>
+#include "hugemem.h"
+#include "kernels.h"
+
+/*
+ * In-process version of the simple_stream.c Copy kernel.
+ *
+ * The arrays come from hugemem_alloc() (huge pages when available, pre-faulted
+ * and locked) in stream_sampler_init(), so every later pass measures
+ * steady-state bandwidth instead of page faults and TLB misses.
+ * Each pass produces one bandwidth sample in MB/s (same units as the "Copy:"
+ * line printed by simple_stream).
+ */
+struct stream_sampler {
+    struct hugemem ma, mc;
+    double *a;
+    double *c;
+    size_t  n;          /* elements per array */
+    const struct mem_kernel *kernel;
+    double  bytes;      /* bytes moved by one pass */
+    double  last_pass;  /* duration of the most recent pass, seconds */
+};
+
+struct placement;
+
+/*
+ * pl (may be NULL) binds both arrays to a node and, when it lists CPUs,
+ * runs the OpenMP team with one thread pinned to each of them.
+ */
+int    stream_sampler_init(struct stream_sampler *s, size_t n,
+                           const struct placement *pl);
+void   stream_sampler_free(struct stream_sampler *s);
+/*
+ * Sizes the arrays from the LLC (topology_llc_bytes()) and the kernel's
+ * measured bandwidth so that one pass takes about `period` seconds, then
+ * initializes as above with kernel k.  A pass never shrinks below the LLC,
+ * so on large-cache parts it may come out longer than `period`; check
+ * last_pass.
+ */
+int    stream_sampler_init_period(struct stream_sampler *s, double period,
+                                  const struct placement *pl,
+                                  const struct mem_kernel *k);
+/* Switches the pass kernel (default: kernel_select(NULL)) and warms it up. */
+void   stream_sampler_set_kernel(struct stream_sampler *s, const struct mem_kernel *k);
+
+/* Runs a single pass of the kernel and returns its bandwidth in MB/s. */
+double stream_sampler_once(struct stream_sampler *s);
+
+/*
+ * Runs back-to-back passes until `until` (mysecond() time base) or until
+ * `max` samples are stored.  A pass is only started if it is expected to
+ * finish before `until`.  Bandwidth goes to bw[], the pass midpoint time
+ * to ts[] when ts is non-NULL.  Returns the number of samples written.
+ */
+int    stream_sampler_run(struct stream_sampler *s, double until,
+                          double *bw, double *ts, int max);
+
+#endif
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sync.h"
+#include "timing.h"
+
+const char sync_preamble[SYNC_LEN + 1] = "1111100110101";
+
+double sync_tx_start(double chip)
+{
+    return ceil((mysecond() + SYNC_LEAD) / chip) * chip;
+}
+
+void sync_send_preamble(double start, double chip, sync_chip_fn on, sync_chip_fn off, void *arg)
+{
+    for (int k = 0; k < SYNC_LEN; k++) {
+        double end = start + (k + 1) * chip;
+
+        sleep_until(start + k * chip);
+        if (sync_preamble[k] == '1') on(arg, end);
+        else if (off)                off(arg, end);
+        else                         sleep_until(end);
+    }
+}
+
+/* first index with t[i] >= x */
+static int lower_bound(const double *t, int n, double x)
+{
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (t[mid] < x) lo = mid + 1;
+        else            hi = mid;
+    }
+    return lo;
+}
+
+int sync_detect(const double *t, const double *bw, int n, double chip,
+                double from, struct sync_result *r)
+{
+    double tmpl[SYNC_LEN], tmean = 0.0, tnorm = 0.0;
+    double step = chip / SYNC_STEPS;
+    double best = 0.0, best_start = 0.0, best_l0 = 0.0, best_l1 = 0.0;
+    int    k, i;
+
+    if (n < 2) return -1;
+
+    /* idle chips raise bandwidth, so they carry the positive sign */
+    for (k = 0; k < SYNC_LEN; k++) {
+        tmpl[k] = sync_preamble[k] == '0' ? 1.0 : -1.0;
+        tmean  += tmpl[k];
+    }
+    tmean /= SYNC_LEN;
+    for (k = 0; k < SYNC_LEN; k++) {
+        tmpl[k] -= tmean;
+        tnorm   += tmpl[k] * tmpl[k];
+    }
+
+    double *pre = malloc((n + 1) * sizeof(double));
+    if (!pre) { perror("sync: malloc"); return -1; }
+    pre[0] = 0.0;
+    for (i = 0; i < n; i++)
+        pre[i + 1] = pre[i] + bw[i];
+
+    double lo = from > t[0] ? from : t[0];
+    double hi = t[n - 1] - (SYNC_LEN + 1) * chip;
+
+    for (double s = lo; s <= hi; s += step) {
+        double x[SYNC_LEN], xmean = 0.0;
+        double sum0 = 0.0, sum1 = 0.0;
+        int    n0 = 0, n1 = 0, ok = 1;
+
+        for (k = 0; k < SYNC_LEN && ok; k++) {
+            int i0 = lower_bound(t, n, s + k * chip);
+            int i1 = lower_bound(t, n, s + (k + 1) * chip);
+            if (i1 == i0) { ok = 0; break; }
+            x[k]   = (pre[i1] - pre[i0]) / (i1 - i0);
+            xmean += x[k];
+            if (sync_preamble[k] == '0') { sum0 += x[k]; n0++; }
+            else                         { sum1 += x[k]; n1++; }
+        }
+        if (!ok) continue;
+        xmean /= SYNC_LEN;
+
+        double dot = 0.0, xnorm = 0.0;
+        for (k = 0; k < SYNC_LEN; k++) {
+            dot   += (x[k] - xmean) * tmpl[k];
+            xnorm += (x[k] - xmean) * (x[k] - xmean);
+        }
+        if (xnorm <= 0.0) continue;
+
+        double corr = dot / sqrt(xnorm * tnorm);
+        if (corr > best) {
+            best       = corr;
+            best_start = s;
+            best_l0    = sum0 / n0;
+            best_l1    = sum1 / n1;
+        }
+    }
+    free(pre);
+
+    if (best < SYNC_MIN_CORR) return -1;
+    if (best_l0 <= 0.0 || (best_l0 - best_l1) / best_l0 < SYNC_MIN_DEPTH) return -1;
+    /* wait until candidates up to one chip later have been scored too */
+    if (best_start + (SYNC_LEN + 2) * chip > t[n - 1]) return -1;
+
+    r->start  = best_start;
+    r->corr   = best;
+    r->level0 = best_l0;
+    r->level1 = best_l1;
+    r->offset = best_start - round(best_start / chip) * chip;
+    return 0;
+}
+
+int sync_wait(struct stream_sampler *s, double chip, double timeout,
+              struct sync_result *r)
+{
+    static double t[SYNC_MAX_SAMPLES], bw[SYNC_MAX_SAMPLES];
+    double deadline = mysecond() + timeout;
+    int    n = 0;
+
+    while (mysecond() < deadline) {
+        if (n > SYNC_MAX_SAMPLES * 3 / 4) {
+            int keep = SYNC_MAX_SAMPLES / 4;
+            memmove(t,  t  + n - keep, keep * sizeof(double));
+            memmove(bw, bw + n - keep, keep * sizeof(double));
+            n = keep;
+        }
+
+        double batch = chip > 2 * s->last_pass ? chip : 2 * s->last_pass;
+        n += stream_sampler_run(s, mysecond() + batch, bw + n, t + n,
+                                SYNC_MAX_SAMPLES - n);
+        if (n == 0) continue;
+
+        double from = t[n - 1] - (SYNC_LEN + 3) * chip;
+        if (sync_detect(t, bw, n, chip, from, r) == 0)
+            return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,63 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include "stream_sampler.h"
+
+/*
+ * Preamble synchronization for the bandwidth channel.
+ *
+ * The transmitter sends the 13-chip Barker sequence (chip '1' = hammered,
+ * '0' = idle) followed by SYNC_GUARD idle chips, and the payload starts
+ * right after.  The receiver records timestamped bandwidth samples and
+ * slides a chip-spaced correlator over them in 1/SYNC_STEPS chip steps;
+ * the best match above SYNC_MIN_CORR gives the preamble start on the
+ * receiver's clock, plus the idle and hammered bandwidth levels.
+ *
+ * A match is only accepted once candidates up to one chip past it have been
+ * scored, so the receiver learns about the preamble about two chips after
+ * it ended; the guard leaves one more chip of slack before the payload.
+ */
+#define SYNC_LEN      13
+#define SYNC_GUARD    3
+#define SYNC_CHIPS    (SYNC_LEN + SYNC_GUARD)
+#define SYNC_LEAD     0.1     /* seconds between transmitter start and preamble */
+#define SYNC_STEPS    8
+#define SYNC_MIN_CORR 0.8
+#define SYNC_MIN_DEPTH 0.02   /* (level0 - level1) / level0 */
+#define SYNC_MAX_SAMPLES 65536
+
+extern const char sync_preamble[SYNC_LEN + 1];
+
+struct sync_result {
+    double start;    /* time of the first preamble chip */
+    double corr;     /* normalized correlation of the match, 0..1 */
+    double level0;   /* mean bandwidth over idle chips, MB/s */
+    double level1;   /* mean bandwidth over hammered chips, MB/s */
+    double offset;   /* start minus the nearest chip-grid point, seconds */
+};
+
+/* Preamble start for a transmitter that begins now: next chip-grid point after SYNC_LEAD. */
+double sync_tx_start(double chip);
+
+/*
+ * Transmitter side of the preamble, for any channel: chip k runs from
+ * start + k * chip, and on(arg, end) / off(arg, end) fill a '1' / '0' chip
+ * and return at its end.  off may be NULL, which sleeps through '0' chips.
+ * The payload starts SYNC_CHIPS chips after start.
+ */
+typedef void (*sync_chip_fn)(void *arg, double end);
+void   sync_send_preamble(double start, double chip, sync_chip_fn on, sync_chip_fn off, void *arg);
+
+/*
+ * Searches samples (t[] ascending, bw[] in MB/s) for a complete preamble
+ * that ended at least one chip before the newest sample.  Only candidates
+ * starting after `from` are tried.  Returns 0 and fills *r on a match.
+ */
+int    sync_detect(const double *t, const double *bw, int n, double chip,
+                   double from, struct sync_result *r);
+
+/* Samples with `s` until a preamble is found or `timeout` seconds pass. */
+int    sync_wait(struct stream_sampler *s, double chip, double timeout,
+                 struct sync_result *r);
+
+#endif
@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "timing.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define CALIBRATION_TIME 0.05
+
+double timing_tsc_hz      = 0.0;
+double timing_spin_margin = 200e-6;
+
+double mysecond(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1.e-9;
+}
+
+uint64_t timing_rdtsc(void)
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+#ifdef HAVE_TSC
+static int tsc_invariant(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+        return 0;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx >> 8) & 1;
+}
+#endif
+
+int timing_init(void)
+{
+#ifdef HAVE_TSC
+    if (!tsc_invariant()) {
+        fprintf(stderr, "timing: TSC is not invariant, using clock_gettime only\n");
+        return -1;
+    }
+
+    double   t0 = mysecond();
+    uint64_t c0 = __rdtsc();
+    while (mysecond() - t0 < CALIBRATION_TIME)
+        ;
+    double   t1 = mysecond();
+    uint64_t c1 = __rdtsc();
+
+    timing_tsc_hz = (double)(c1 - c0) / (t1 - t0);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+void sleep_until(double target)
+{
+    double remaining = target - mysecond();
+    if (remaining <= 0.0) return;
+
+    if (remaining > timing_spin_margin) {
+        double coarse = remaining - timing_spin_margin;
+        struct timespec ts;
+        ts.tv_sec  = (time_t)coarse;
+        ts.tv_nsec = (long)((coarse - ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    }
+
+#ifdef HAVE_TSC
+    if (timing_tsc_hz > 0.0) {
+        remaining = target - mysecond();
+        if (remaining <= 0.0) return;
+        uint64_t deadline = __rdtsc() + (uint64_t)(remaining * timing_tsc_hz);
+        while (__rdtsc() < deadline)
+            _mm_pause();
+        return;
+    }
+#endif
+    while (mysecond() < target)
+        ;
+}
+
+static void plain_sleep_until(double target)
+{
+    double remaining = target - mysecond();
+    if (remaining <= 0.0) return;
+    struct timespec ts;
+    ts.tv_sec  = (time_t)remaining;
+    ts.tv_nsec = (long)((remaining - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+static int cmp_double(const void *x, const void *y)
+{
+    double a = *(const double *)x, b = *(const double *)y;
+    return (a > b) - (a < b);
+}
+
+static void jitter_run(const char *name, void (*sleeper)(double),
+                       double *over, int n, double period)
+{
+    double start = mysecond() + period;
+    int    i;
+
+    for (i = 0; i < n; i++) {
+        double target = start + i * period;
+        sleeper(target);
+        over[i] = mysecond() - target;
+    }
+    qsort(over, n, sizeof(double), cmp_double);
+
+    printf("%-12s %9.2f %9.2f %9.2f %9.2f %9.2f\n", name,
+           1e6 * over[n / 2],
+           1e6 * over[(int)(n * 0.90)],
+           1e6 * over[(int)(n * 0.99)],
+           1e6 * over[(int)(n * 0.999)],
+           1e6 * over[n - 1]);
+}
+
+void timing_jitter_bench(int n, double period)
+{
+    double *over = malloc(n * sizeof(double));
+    if (!over) { perror("malloc"); return; }
+
+    printf("timing: TSC %.3f GHz, spin margin %.0f us, %d wake-ups every %.0f us\n",
+           timing_tsc_hz * 1e-9, timing_spin_margin * 1e6, n, period * 1e6);
+    printf("overshoot us      p50       p90       p99     p99.9       max\n");
+    jitter_run("nanosleep",   plain_sleep_until, over, n, period);
+    jitter_run("sleep_until", sleep_until,       over, n, period);
+
+    free(over);
+}
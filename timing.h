@@ -0,0 +1,32 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+
+/*
+ * Shared time base for the covert-channel programs.
+ *
+ * mysecond() reads CLOCK_MONOTONIC_RAW, which is the same in every process
+ * on the host and never steps under NTP.  timing_init() additionally
+ * calibrates the TSC against it; when the TSC is invariant, the final
+ * approach of sleep_until() and cycle-level measurements use rdtsc.
+ *
+ * sleep_until() sleeps in the kernel until `timing_spin_margin` seconds
+ * before the target and then spins, so wake-up overshoot is set by the spin
+ * loop (tens of ns) rather than by timer slack (50-100 us).
+ */
+extern double timing_tsc_hz;       /* 0 when the TSC is not usable */
+extern double timing_spin_margin;  /* seconds, default 200 us */
+
+int      timing_init(void);
+double   mysecond(void);
+void     sleep_until(double target);
+uint64_t timing_rdtsc(void);
+
+/*
+ * Sleeps `n` times to a `period`-spaced schedule, once with a plain
+ * nanosleep and once with sleep_until(), and prints overshoot percentiles.
+ */
+void     timing_jitter_bench(int n, double period);
+
+#endif
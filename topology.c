@@ -0,0 +1,264 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "topology.h"
+
+#define SYS_CPU  "/sys/devices/system/cpu"
+#define SYS_NODE "/sys/devices/system/node"
+
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+
+static int read_int(const char *path, int fallback)
+{
+    FILE *f = fopen(path, "r");
+    int   v = fallback;
+    if (!f) return fallback;
+    if (fscanf(f, "%d", &v) != 1) v = fallback;
+    fclose(f);
+    return v;
+}
+
+int topology_parse_cpulist(const char *s, int *cpus, int max)
+{
+    int n = 0;
+
+    while (*s && *s != '\n') {
+        char *end;
+        long  lo = strtol(s, &end, 10), hi = lo;
+        if (end == s) return -1;
+        s = end;
+        if (*s == '-') {
+            hi = strtol(s + 1, &end, 10);
+            if (end == s + 1 || hi < lo) return -1;
+            s = end;
+        }
+        for (long c = lo; c <= hi && n < max; c++)
+            cpus[n++] = (int)c;
+        if (*s == ',') s++;
+        else if (*s && *s != '\n') return -1;
+    }
+    return n;
+}
+
+int topology_load(struct topology *t)
+{
+    char path[256], line[4096];
+    int  cpus[TOPO_MAX_CPUS], n, i;
+    FILE *f;
+
+    memset(t, 0, sizeof(*t));
+
+    f = fopen(SYS_CPU "/online", "r");
+    if (!f || !fgets(line, sizeof(line), f)) {
+        if (f) fclose(f);
+        fprintf(stderr, "topology: cannot read " SYS_CPU "/online\n");
+        return -1;
+    }
+    fclose(f);
+    n = topology_parse_cpulist(line, cpus, TOPO_MAX_CPUS);
+    if (n <= 0) return -1;
+
+    for (i = 0; i < n; i++) {
+        struct topo_cpu *c = &t->cpus[i];
+        c->cpu = cpus[i];
+        snprintf(path, sizeof(path), SYS_CPU "/cpu%d/topology/core_id", c->cpu);
+        c->core = read_int(path, c->cpu);
+        snprintf(path, sizeof(path), SYS_CPU "/cpu%d/topology/physical_package_id", c->cpu);
+        c->package = read_int(path, 0);
+        c->node = 0;
+    }
+    t->ncpus  = n;
+    t->nnodes = 1;
+
+    /* node<N>/cpulist maps CPUs to NUMA nodes */
+    for (int node = 0; node < 64; node++) {
+        int ncpu;
+        snprintf(path, sizeof(path), SYS_NODE "/node%d/cpulist", node);
+        f = fopen(path, "r");
+        if (!f) continue;
+        if (fgets(line, sizeof(line), f)) {
+            ncpu = topology_parse_cpulist(line, cpus, TOPO_MAX_CPUS);
+            for (int k = 0; k < ncpu; k++)
+                for (i = 0; i < t->ncpus; i++)
+                    if (t->cpus[i].cpu == cpus[k]) t->cpus[i].node = node;
+        }
+        fclose(f);
+        if (node + 1 > t->nnodes) t->nnodes = node + 1;
+    }
+    return 0;
+}
+
+void topology_print(const struct topology *t, FILE *f)
+{
+    fprintf(f, "topology: %d CPU(s), %d NUMA node(s)\n", t->ncpus, t->nnodes);
+    fprintf(f, "  cpu  core  package  node\n");
+    for (int i = 0; i < t->ncpus; i++)
+        fprintf(f, "  %3d  %4d  %7d  %4d\n", t->cpus[i].cpu, t->cpus[i].core,
+                t->cpus[i].package, t->cpus[i].node);
+}
+
+size_t topology_llc_bytes(void)
+{
+    char   path[256], type[32], unit = 0;
+    size_t best = 0;
+    int    best_level = 0;
+
+    for (int i = 0; i < 16; i++) {
+        FILE  *f;
+        int    level;
+        size_t kb;
+
+        snprintf(path, sizeof(path), SYS_CPU "/cpu0/cache/index%d/level", i);
+        if ((level = read_int(path, -1)) < 0) break;
+
+        snprintf(path, sizeof(path), SYS_CPU "/cpu0/cache/index%d/type", i);
+        if (!(f = fopen(path, "r"))) continue;
+        if (fscanf(f, "%31s", type) != 1 || strcmp(type, "Instruction") == 0) {
+            fclose(f);
+            continue;
+        }
+        fclose(f);
+
+        snprintf(path, sizeof(path), SYS_CPU "/cpu0/cache/index%d/size", i);
+        if (!(f = fopen(path, "r"))) continue;
+        if (fscanf(f, "%zu%c", &kb, &unit) >= 1 && level >= best_level) {
+            best       = unit == 'M' ? kb << 20 : unit == 'K' ? kb << 10 : kb;
+            best_level = level;
+        }
+        fclose(f);
+    }
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    if (!best) {
+        long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (l3 > 0) best = (size_t)l3;
+    }
+#endif
+    return best;
+}
+
+int topology_llc_ways(void)
+{
+    char path[256], type[32];
+    int  ways = 0, best_level = 0;
+
+    for (int i = 0; i < 16; i++) {
+        FILE *f;
+        int   level, w;
+
+        snprintf(path, sizeof(path), SYS_CPU "/cpu0/cache/index%d/level", i);
+        if ((level = read_int(path, -1)) < 0) break;
+
+        snprintf(path, sizeof(path), SYS_CPU "/cpu0/cache/index%d/type", i);
+        if (!(f = fopen(path, "r"))) continue;
+        if (fscanf(f, "%31s", type) != 1 || strcmp(type, "Instruction") == 0) {
+            fclose(f);
+            continue;
+        }
+        fclose(f);
+
+        snprintf(path, sizeof(path), SYS_CPU "/cpu0/cache/index%d/ways_of_associativity", i);
+        if ((w = read_int(path, 0)) > 0 && level >= best_level) {
+            ways       = w;
+            best_level = level;
+        }
+    }
+    return ways;
+}
+
+int placement_init(struct placement *pl, const char *cpulist, int node)
+{
+    pl->ncpus = 0;
+    pl->node  = node;
+    if (cpulist) {
+        pl->ncpus = topology_parse_cpulist(cpulist, pl->cpus, TOPO_MAX_CPUS);
+        if (pl->ncpus < 0) {
+            fprintf(stderr, "topology: bad CPU list '%s'\n", cpulist);
+            pl->ncpus = 0;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int placement_online(struct placement *pl)
+{
+    char  line[4096];
+    FILE *f = fopen(SYS_CPU "/online", "r");
+    int   n = -1;
+
+    if (f && fgets(line, sizeof(line), f))
+        n = topology_parse_cpulist(line, pl->cpus, TOPO_MAX_CPUS);
+    if (f) fclose(f);
+    if (n <= 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        for (n = 0; n < ncpu && n < TOPO_MAX_CPUS; n++)
+            pl->cpus[n] = n;
+    }
+    pl->ncpus = n;
+    return 0;
+}
+
+int placement_from_node(struct placement *pl, const struct topology *t, int node)
+{
+    pl->ncpus = 0;
+    pl->node  = node;
+    for (int i = 0; i < t->ncpus; i++)
+        if (t->cpus[i].node == node) pl->cpus[pl->ncpus++] = t->cpus[i].cpu;
+    return pl->ncpus ? 0 : -1;
+}
+
+void placement_print(const struct placement *pl, const char *who, FILE *f)
+{
+    fprintf(f, "%s: cpus ", who);
+    if (!pl->ncpus) fprintf(f, "unpinned");
+    for (int i = 0; i < pl->ncpus; i++)
+        fprintf(f, "%s%d", i ? "," : "", pl->cpus[i]);
+    if (pl->node >= 0) fprintf(f, ", memory on node %d\n", pl->node);
+    else               fprintf(f, ", default memory policy\n");
+}
+
+int placement_cpu(const struct placement *pl, int i)
+{
+    if (!pl || !pl->ncpus) return -1;
+    return pl->cpus[i % pl->ncpus];
+}
+
+int topology_pin_thread(pthread_t th, int cpu)
+{
+    cpu_set_t set;
+    if (cpu < 0) return 0;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(th, sizeof(set), &set) == 0 ? 0 : -1;
+}
+
+int topology_pin_self(int cpu)
+{
+    return topology_pin_thread(pthread_self(), cpu);
+}
+
+int topology_bind_memory(void *addr, size_t len, int node)
+{
+    unsigned long mask[4] = { 0 };
+    long          page = sysconf(_SC_PAGESIZE);
+    uintptr_t     lo, hi;
+
+    if (node < 0) return 0;
+    if (node >= (int)(8 * sizeof(mask))) return -1;
+    mask[node / (8 * sizeof(long))] |= 1UL << (node % (8 * sizeof(long)));
+
+    /* mbind wants page-aligned ranges */
+    lo = (uintptr_t)addr & ~(uintptr_t)(page - 1);
+    hi = ((uintptr_t)addr + len + page - 1) & ~(uintptr_t)(page - 1);
+    if (syscall(SYS_mbind, lo, hi - lo, MPOL_BIND, mask,
+                8 * sizeof(mask) + 1, 0) != 0)
+        return -1;
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/*
+ * CPU/NUMA layout from /sys/devices/system/{cpu,node} and the placement
+ * helpers the channel programs use to pin threads and bind buffers.
+ *
+ * Memory binding goes through the mbind/set_mempolicy system calls
+ * directly, so there is no libnuma dependency; on kernels without NUMA
+ * support binding fails quietly and the default policy stays in effect.
+ */
+#define TOPO_MAX_CPUS 1024
+
+struct topo_cpu {
+    int cpu;
+    int core;       /* core_id within the package */
+    int package;    /* physical_package_id */
+    int node;       /* NUMA node, 0 when unknown */
+};
+
+struct topology {
+    int             ncpus;
+    int             nnodes;
+    struct topo_cpu cpus[TOPO_MAX_CPUS];
+};
+
+/* Where a program should run: cpus[] round-robin for its threads, buffers on node. */
+struct placement {
+    int cpus[TOPO_MAX_CPUS];
+    int ncpus;      /* 0 = leave threads unpinned */
+    int node;       /* -1 = default memory policy */
+};
+
+int  topology_load(struct topology *t);
+void topology_print(const struct topology *t, FILE *f);
+/* Size of the last-level data/unified cache seen by cpu0, 0 if unknown. */
+size_t topology_llc_bytes(void);
+/* Its associativity, 0 if unknown. */
+int    topology_llc_ways(void);
+
+/* "0-3,8,10-11" -> cpus; returns count or -1 on a malformed list. */
+int  topology_parse_cpulist(const char *s, int *cpus, int max);
+
+/* Fills *pl from a --cpus list (may be NULL) and --node (may be -1). */
+int  placement_init(struct placement *pl, const char *cpulist, int node);
+/* All online CPUs, in order. */
+int  placement_online(struct placement *pl);
+/* All online CPUs of one NUMA node. */
+int  placement_from_node(struct placement *pl, const struct topology *t, int node);
+void placement_print(const struct placement *pl, const char *who, FILE *f);
+
+/* CPU for thread index i under *pl, or -1 when unpinned. */
+int  placement_cpu(const struct placement *pl, int i);
+
+int  topology_pin_thread(pthread_t th, int cpu);
+int  topology_pin_self(int cpu);
+/* Binds [addr, addr+len) to node before it is first touched. */
+int  topology_bind_memory(void *addr, size_t len, int node);
+
+#endif
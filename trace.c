@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "trace.h"
+#include "timing.h"
+
+#define TRACE_MAGIC 0x45434152545743ULL   /* "CWTRACE" */
+#define CAPTURE_MAX 1024                  /* samples per stream_sampler_run call */
+
+int trace_init(struct trace *tr, size_t cap)
+{
+    memset(tr, 0, sizeof(*tr));
+    tr->t  = malloc(cap * sizeof(double));
+    tr->bw = malloc(cap * sizeof(double));
+    if (!tr->t || !tr->bw) {
+        perror("trace: malloc");
+        trace_free(tr);
+        return -1;
+    }
+    tr->cap = cap;
+
+    /* touch the ring now so capture never page-faults */
+    memset(tr->t,  0, cap * sizeof(double));
+    memset(tr->bw, 0, cap * sizeof(double));
+    return 0;
+}
+
+void trace_free(struct trace *tr)
+{
+    free(tr->t);
+    free(tr->bw);
+    tr->t = tr->bw = NULL;
+    tr->cap = tr->head = tr->count = 0;
+}
+
+void trace_push(struct trace *tr, double t, double bw)
+{
+    tr->t[tr->head]  = t;
+    tr->bw[tr->head] = bw;
+    tr->head = (tr->head + 1) % tr->cap;
+    if (tr->count < tr->cap) tr->count++;
+}
+
+void trace_get(const struct trace *tr, size_t i, double *t, double *bw)
+{
+    size_t idx = (tr->head + tr->cap - tr->count + i) % tr->cap;
+    *t  = tr->t[idx];
+    *bw = tr->bw[idx];
+}
+
+size_t trace_capture(struct trace *tr, struct stream_sampler *s, double until)
+{
+    double t[CAPTURE_MAX], bw[CAPTURE_MAX];
+    size_t total = 0;
+
+    while (mysecond() + s->last_pass <= until) {
+        int n = stream_sampler_run(s, until, bw, t, CAPTURE_MAX);
+        for (int k = 0; k < n; k++)
+            trace_push(tr, t[k], bw[k]);
+        total += n;
+    }
+    return total;
+}
+
+int trace_save(const struct trace *tr, const char *path)
+{
+    FILE    *f = fopen(path, "wb");
+    uint64_t magic = TRACE_MAGIC, count = tr->count;
+    double   hdr[4] = { tr->start, tr->symbol, tr->level0, tr->level1 };
+
+    if (!f) { perror(path); return -1; }
+    fwrite(&magic, sizeof(magic), 1, f);
+    fwrite(&count, sizeof(count), 1, f);
+    fwrite(hdr, sizeof(double), 4, f);
+    for (size_t i = 0; i < tr->count; i++) {
+        double rec[2];
+        trace_get(tr, i, &rec[0], &rec[1]);
+        fwrite(rec, sizeof(double), 2, f);
+    }
+    if (fclose(f) != 0) { perror(path); return -1; }
+    return 0;
+}
+
+int trace_load(struct trace *tr, const char *path)
+{
+    FILE    *f = fopen(path, "rb");
+    uint64_t magic = 0, count = 0;
+    double   hdr[4];
+
+    if (!f) { perror(path); return -1; }
+    if (fread(&magic, sizeof(magic), 1, f) != 1 || magic != TRACE_MAGIC ||
+        fread(&count, sizeof(count), 1, f) != 1 ||
+        fread(hdr, sizeof(double), 4, f) != 4) {
+        fprintf(stderr, "%s: not a trace file\n", path);
+        fclose(f);
+        return -1;
+    }
+    if (trace_init(tr, count ? count : 1) != 0) { fclose(f); return -1; }
+    tr->start  = hdr[0];
+    tr->symbol = hdr[1];
+    tr->level0 = hdr[2];
+    tr->level1 = hdr[3];
+
+    for (uint64_t i = 0; i < count; i++) {
+        double rec[2];
+        if (fread(rec, sizeof(double), 2, f) != 2) {
+            fprintf(stderr, "%s: truncated after %llu samples\n", path,
+                    (unsigned long long)i);
+            break;
+        }
+        trace_push(tr, rec[0], rec[1]);
+    }
+    fclose(f);
+    return 0;
+}
+
+/* first index with t[i] >= x */
+static size_t lower_bound(const double *t, size_t n, double x)
+{
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (t[mid] < x) lo = mid + 1;
+        else            hi = mid;
+    }
+    return lo;
+}
+
+/* mean bandwidth of every window for one phase; returns mean |level - threshold| */
+static double slice_phase(const double *t, const double *pre, size_t n,
+                          const struct slice_params *p, double phase,
+                          double *levels)
+{
+    double margin = 0.0;
+    int    used   = 0;
+
+    for (int k = 0; k < p->nsymbols; k++) {
+        double ws = p->start + phase + (k + p->guard) * p->symbol;
+        double we = p->start + phase + (k + 1 - p->guard) * p->symbol;
+        size_t i0 = lower_bound(t, n, ws);
+        size_t i1 = lower_bound(t, n, we);
+
+        if (i1 == i0) { levels[k] = 0.0; continue; }
+        levels[k] = (pre[i1] - pre[i0]) / (double)(i1 - i0);
+        margin   += fabs(levels[k] - p->threshold);
+        used++;
+    }
+    return used ? margin / used : 0.0;
+}
+
+int trace_slice(const struct trace *tr, const struct slice_params *p,
+                double *levels, char *bits, double *phase)
+{
+    size_t  n   = tr->count;
+    double *t   = malloc((n + 1) * sizeof(double));
+    double *pre = malloc((n + 1) * sizeof(double));
+    double *tmp = malloc((p->nsymbols + 1) * sizeof(double));
+    double  best = -1.0, best_phase = 0.0;
+
+    if (!t || !pre || !tmp) {
+        perror("trace: malloc");
+        free(t); free(pre); free(tmp);
+        return -1;
+    }
+
+    pre[0] = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double bw;
+        trace_get(tr, i, &t[i], &bw);
+        pre[i + 1] = pre[i] + bw;
+    }
+
+    /* 0, +1, -1, +2, -2, ... so ties keep the nominal phase */
+    for (int s = 0; s <= 2 * p->steps; s++) {
+        int    k  = (s + 1) / 2 * ((s & 1) ? 1 : -1);
+        double ph = p->steps ? k * p->search * p->symbol / p->steps : 0.0;
+        double m  = slice_phase(t, pre, n, p, ph, tmp);
+        if (m > best) {
+            best       = m;
+            best_phase = ph;
+            memcpy(levels, tmp, p->nsymbols * sizeof(double));
+        }
+        if (!p->steps) break;
+    }
+
+    for (int k = 0; k < p->nsymbols; k++)
+        bits[k] = (levels[k] > 0.0 && levels[k] < p->threshold) ? '1' : '0';
+
+    if (phase) *phase = best_phase;
+    free(t); free(pre); free(tmp);
+    return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include "stream_sampler.h"
+
+/*
+ * Continuous bandwidth trace: a preallocated ring of (time, MB/s) samples.
+ *
+ * trace_capture() fills it from a stream_sampler without any I/O in the
+ * loop; trace_slice() is the separate decoder pass that cuts the trace
+ * into symbol windows, searches the phase offset that best separates the
+ * two levels, and applies the threshold.  A trace can be saved together
+ * with its sync parameters and re-decoded later with different settings.
+ */
+struct trace {
+    double *t;
+    double *bw;
+    size_t  cap;
+    size_t  head;       /* next slot to write */
+    size_t  count;      /* valid samples, <= cap */
+
+    /* channel parameters recorded alongside the samples */
+    double  start;      /* time of symbol 0 */
+    double  symbol;     /* symbol duration, seconds */
+    double  level0;
+    double  level1;
+};
+
+struct slice_params {
+    double start;
+    double symbol;
+    int    nsymbols;
+    double threshold;   /* MB/s; below => '1' */
+    double search;      /* phase search range, +/- fraction of a symbol */
+    int    steps;       /* phase candidates on each side */
+    double guard;       /* fraction trimmed from each window edge */
+};
+
+int    trace_init(struct trace *tr, size_t cap);
+void   trace_free(struct trace *tr);
+void   trace_push(struct trace *tr, double t, double bw);
+
+/* Sample i in chronological order, 0 <= i < count. */
+void   trace_get(const struct trace *tr, size_t i, double *t, double *bw);
+
+/* Records samples until `until`; returns how many were added. */
+size_t trace_capture(struct trace *tr, struct stream_sampler *s, double until);
+
+int    trace_save(const struct trace *tr, const char *path);
+int    trace_load(struct trace *tr, const char *path);
+
+/*
+ * Decodes p->nsymbols symbols into bits[] ('0'/'1', not terminated) and
+ * their mean bandwidth into levels[] (0 for empty windows).  Returns the
+ * chosen phase offset in seconds through *phase.  Returns 0 on success.
+ */
+int    trace_slice(const struct trace *tr, const struct slice_params *p,
+                   double *levels, char *bits, double *phase);
+
+#endif
@@ -1,110 +1,298 @@
-
+/*
+ * Memory-bandwidth covert channel, sender: a contention pool (contention_pool.h)
+ * keeps the memory bus busy for a 1 and idle for a 0.
+ *
+ *  gcc -fopenmp -O3 -pthread transmitter.c contention_pool.c sync.c stream_sampler.c pam4.c \
+ *      topology.c hugemem.c kernels.c framing.c arq.c timing.c -o transmitter -lm
+ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <signal.h>
-#include <sys/wait.h>
-#include <sys/time.h>
 #include <math.h>
+#include "timing.h"
+#include "contention_pool.h"
+#include "sync.h"
+#include "topology.h"
+#include "pam4.h"
+#include "framing.h"
+#include "arq.h"
 
-#define SYNC_FILE    "/tmp/covert_start"
+#define POOL_ELEMS   2000000
 #define BIT_DURATION 0.1  
+#define ACK_SAMPLER_ELEMS 4000000
+
+static struct contention_pool pool;
+static struct stream_sampler  ack_sampler;   /* --arq: listens for the receiver */
+
+static void send_level(int level, double until)
+{
+    contention_pool_set_level(&pool, pam4_workers(level, pool.nthreads));
+    sleep_until(until);
+    contention_pool_set_level(&pool, 0);
+}
 
-double mysecond()
+static void send_binary(const char *bits, size_t len, double start_time)
 {
-        struct timeval tp;
-        struct timezone tzp;
-        int i;
+    for (size_t i = 0; i < len; i++) {
+        char bit = bits[i];
+        double bit_start = start_time + i * BIT_DURATION;
+        double bit_end = start_time + (i + 1) * BIT_DURATION;
+
+        sleep_until(bit_start);
 
-        i = gettimeofday(&tp,&tzp);
-        return ( (double) tp.tv_sec + (double) tp.tv_usec * 1.e-6 );
+        printf("transmitter: bit %zu = '%c' -> %s starting at time = %.3f\n", i, bit, bit == '1' ? "hammered" : "slept", mysecond());
+        fflush(stdout);
+
+        if (bit == '1')
+            contention_pool_chip(&pool, bit_end); 
+        else
+            sleep_until(bit_end);
+
+    }
 }
 
-static void sleep_until(double target)
+/* Sends nbits of frame from symbol slot `slot` on; returns the next free slot. */
+static size_t send_frame(const uint8_t *frame, size_t nbits, size_t slot, double start_time)
 {
-    double remaining = target - mysecond();
-    if (remaining <= 0.0) return;
-    struct timespec ts;
-    ts.tv_sec  = (time_t)remaining;
-    ts.tv_nsec = (long)((remaining - ts.tv_sec) * 1e9);
-    nanosleep(&ts, NULL);
+    for (size_t i = 0; i < nbits; i++, slot++) {
+        double bit_start = start_time + slot * BIT_DURATION;
+        sleep_until(bit_start);
+        if (frame_bit(frame, i))
+            contention_pool_chip(&pool, bit_start + BIT_DURATION);
+    }
+    return slot;
+}
+
+/*
+ * Streams `in` as frames of up to `chunk` payload bytes, back to back.
+ * One chunk is read ahead so the final frame can carry FRAME_LAST; an
+ * empty input still sends one empty last frame.
+ */
+static int send_payload(FILE *in, size_t chunk, double start_time)
+{
+    static uint8_t cur[FRAME_MAX_PAYLOAD], next[FRAME_MAX_PAYLOAD];
+    static uint8_t frame[FRAME_MAX_BYTES];
+    size_t   n = fread(cur, 1, chunk, in), slot = 0, total = 0;
+    uint16_t seq = 0;
+
+    for (;;) {
+        size_t m    = n == chunk ? fread(next, 1, chunk, in) : 0;
+        int    last = m == 0;
+        size_t len  = frame_build(frame, seq, last ? FRAME_LAST : 0, cur, n);
+
+        printf("transmitter: frame %u, %zu byte(s)%s, %zu bits starting at time = %.3f\n",
+               seq, n, last ? ", last" : "", 8 * len, start_time + slot * BIT_DURATION);
+        fflush(stdout);
+        slot   = send_frame(frame, 8 * len, slot, start_time);
+        total += n;
+        if (last) break;
+
+        memcpy(cur, next, m);
+        n = m;
+        seq++;
+    }
+    if (ferror(in)) {
+        perror("transmitter: read");
+        return -1;
+    }
+    printf("transmitter: %zu byte(s) in %u frame(s)\n", total, seq + 1);
+    return 0;
+}
+
+/* Mean bandwidth the ack sampler sees in one slot, 0 if no pass fit. */
+static double listen_slot(double slot_start)
+{
+    double bw[256], sum = 0.0;
+    int    n;
+
+    sleep_until(slot_start + BIT_DURATION*0.01);
+    n = stream_sampler_run(&ack_sampler, slot_start + BIT_DURATION*0.95, bw, NULL, 256);
+    for (int k = 0; k < n; k++) sum += bw[k];
+    return n ? sum / n : 0.0;
 }
 
-static void hammer_memory(double until) {
-    while (mysecond() < until) {
+/*
+ * ARQ version of send_payload(): one frame per round (arq.h), each resent
+ * until the receiver acknowledges it or ARQ_RETRIES resends fail.
+ */
+static int send_payload_arq(FILE *in, size_t chunk, double start_time)
+{
+    static uint8_t cur[FRAME_MAX_PAYLOAD], next[FRAME_MAX_PAYLOAD];
+    static uint8_t frame[FRAME_MAX_BYTES];
+    size_t   n = fread(cur, 1, chunk, in), total = 0, round = 0, resent = 0;
+    size_t   round_slots = arq_round_slots(chunk);
+    uint16_t seq = 0;
+
+    for (;;) {
+        size_t m    = n == chunk ? fread(next, 1, chunk, in) : 0;
+        int    last = m == 0;
+        size_t len  = frame_build(frame, seq, last ? FRAME_LAST : 0, cur, n);
+        int    ack  = 0;
+
+        for (int attempt = 0; !ack && attempt <= ARQ_RETRIES; attempt++, round++) {
+            size_t slot = round * round_slots;
+            double bw[ARQ_ACK_SLOTS], margin;
 
-        pid_t pid = fork();
+            printf("transmitter: round %zu, frame %u, %zu byte(s)%s%s\n", round, seq, n,
+                   last ? ", last" : "", attempt ? ", resend" : "");
+            fflush(stdout);
+            send_frame(frame, 8 * len, slot, start_time);
+            for (int k = 0; k < ARQ_ACK_SLOTS; k++)
+                bw[k] = listen_slot(start_time + (slot + arq_ack_slot(chunk, k)) * BIT_DURATION);
 
-        if (pid == 0) {
-            int devnull = open("/dev/null", O_WRONLY);
-            dup2(devnull, STDOUT_FILENO);
-            dup2(devnull, STDERR_FILENO);
-            close(devnull);
-            execl("./simple_stream", "simple_stream", NULL);
-            perror("execl failed");
-            _exit(1);
+            int answer = arq_decide(bw, ARQ_ACK_SLOTS, &margin);
+            printf("transmitter: frame %u %s (contrast %+.3f)\n", seq,
+                   answer > 0 ? "acknowledged" : answer == 0 ? "NACK" : "no clear answer", margin);
+            ack = answer > 0;
+            if (!ack) resent++;
+        }
+        if (!ack) {
+            fprintf(stderr, "transmitter: frame %u unacknowledged after %d resends, giving up\n",
+                    seq, ARQ_RETRIES);
+            return -1;
         }
+        total += n;
+        if (last) break;
 
-        else if (pid > 0) {
-            int status;
-
-            while (1) {
-                if (mysecond() >= until) {
-                    kill(pid, SIGKILL);
-                    waitpid(pid, NULL, 0);
-                    return; 
-                }
-                pid_t result = waitpid(pid, &status, WNOHANG);
-                if (result == pid) {
-                    break; 
-                }
-            }
+        memcpy(cur, next, m);
+        n = m;
+        seq++;
+    }
+    if (ferror(in)) {
+        perror("transmitter: read");
+        return -1;
+    }
+    printf("transmitter: %zu byte(s) in %u frame(s), %zu resend(s), %zu round(s)\n",
+           total, seq + 1, resent, round);
+    return 0;
+}
+
+static void send_pam4(const char *bits, size_t len, double start_time)
+{
+    size_t nsym = PAM4_TRAIN_LEN + (len + 1) / 2;
+
+    for (size_t s = 0; s < nsym; s++) {
+        double sym_start = start_time + s * BIT_DURATION;
+        double sym_end   = start_time + (s + 1) * BIT_DURATION;
+        int    level;
+
+        if (s < PAM4_TRAIN_LEN) {
+            level = PAM4_TRAIN[s] - '0';
+        } else {
+            size_t i  = 2 * (s - PAM4_TRAIN_LEN);
+            int    b0 = bits[i] == '1';
+            int    b1 = i + 1 < len && bits[i + 1] == '1';
+            level = pam4_level(b0, b1);
         }
+
+        sleep_until(sym_start);
+        printf("transmitter: symbol %zu%s = level %d (%d/%d workers) starting at time = %.3f\n",
+               s, s < PAM4_TRAIN_LEN ? " (training)" : "", level,
+               pam4_workers(level, pool.nthreads), pool.nthreads, mysecond());
+        fflush(stdout);
+        send_level(level, sym_end);
     }
 }
 
 int main(int argc, char *argv[])
 {
-    const char *bits = NULL;
-    for (int i = 1; i < argc; i++)
-        if (strcmp(argv[i], "--binary") == 0 && i+1 < argc)
-            bits = argv[++i];
+    timing_init();
 
-    if (!bits) {
-        fprintf(stderr, "Usage: %s --binary \"01010101...\"\n", argv[0]);
-        return 1;
+    const char *bits     = NULL;
+    int         nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long        elems    = POOL_ELEMS;
+    const char *cpus     = NULL;
+    const char *kernel   = NULL;
+    int         node     = -1;
+    int         pam4     = 0;
+    const char *in_path  = NULL;
+    long        chunk    = FRAME_PAYLOAD;
+    int         arq      = 0;
+    const char *ack_cpus = NULL;
+    for (int i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--binary")  == 0 && i+1 < argc) bits     = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) nthreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--elems")   == 0 && i+1 < argc) elems    = atol(argv[++i]);
+        else if (strcmp(argv[i], "--cpus")    == 0 && i+1 < argc) cpus     = argv[++i];
+        else if (strcmp(argv[i], "--node")    == 0 && i+1 < argc) node     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--kernel")  == 0 && i+1 < argc) kernel   = argv[++i];
+        else if (strcmp(argv[i], "--pam4")    == 0)               pam4     = 1;
+        else if (strcmp(argv[i], "--in")      == 0 && i+1 < argc) in_path  = argv[++i];
+        else if (strcmp(argv[i], "--frame")   == 0 && i+1 < argc) chunk    = atol(argv[++i]);
+        else if (strcmp(argv[i], "--arq")     == 0)               arq      = 1;
+        else if (strcmp(argv[i], "--ack-cpus") == 0 && i+1 < argc) ack_cpus = argv[++i];
     }
 
-    double start_time = floor(mysecond() / 60.0) * 60.0 + 60.0;  //get rid of this and sync up at the nxt minuite or something
+    if (!bits == !in_path) {
+        fprintf(stderr, "Usage: %s --binary \"01010101...\" [--pam4]\n"
+                        "       %s --in FILE|- [--frame BYTES] [--arq [--ack-cpus LIST]]\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (in_path && (pam4 || chunk < 1 || chunk > FRAME_MAX_PAYLOAD)) {
+        fprintf(stderr, "transmitter: --in needs binary mode and 1 <= --frame <= %d\n",
+                FRAME_MAX_PAYLOAD);
+        return 1;
+    }
+    if (arq && !in_path) {
+        fprintf(stderr, "transmitter: --arq needs --in\n");
+        return 1;
+    }
+    FILE *in = NULL;
+    if (in_path && !(in = strcmp(in_path, "-") == 0 ? stdin : fopen(in_path, "rb"))) {
+        perror(in_path);
+        return 1;
+    }
+    if (pam4 && nthreads < 3)
+        fprintf(stderr, "transmitter: --pam4 needs at least 3 threads for distinct levels\n");
 
+    struct placement pl;
+    if (placement_init(&pl, cpus, node) != 0) return 1;
+    if (!pl.ncpus) placement_online(&pl);
+    placement_print(&pl, "transmitter", stdout);
 
-    printf("transmitter: bit 0 starts in ~2s\n");
+    const struct mem_kernel *k = kernel_select(kernel);
+    if (!k) return 1;
+    printf("transmitter: %d worker(s) running the %s kernel\n", nthreads, k->name);
 
-    for (size_t i = 0; i < strlen(bits); i++) {
-        char bit = bits[i];
-        double bit_start = start_time + i * BIT_DURATION;
-        double bit_end = start_time + (i + 1) * BIT_DURATION;
-        
-        if(i==0){
-            sleep_until(bit_start-1); 
-        }else{
-            sleep_until(bit_start); 
-        }
+    if (contention_pool_start(&pool, nthreads, (size_t)elems, &pl) != 0) return 1;
+    contention_pool_set_kernel(&pool, k);
+    if (arq) {
+        /*
+         * Without --ack-cpus the ACK sampler shares the workers' cores; it
+         * only samples in the ACK slots, when the gate is closed and the
+         * workers are parked (contention_pool.h).
+         */
+        struct placement ackpl = pl;
+        if (ack_cpus && placement_init(&ackpl, ack_cpus, node) != 0) return 1;
+        if (ack_cpus) placement_print(&ackpl, "transmitter: ack sampler", stdout);
+        if (stream_sampler_init(&ack_sampler, ACK_SAMPLER_ELEMS, &ackpl) != 0) return 1;
+        printf("transmitter: ARQ, %zu slots per round, listening with %zu elements (%.3f ms per pass)\n",
+               arq_round_slots((size_t)chunk), ack_sampler.n, 1e3 * ack_sampler.last_pass);
+    }
 
-        printf("transmitter: bit %zu = '%c' -> %s starting at time = %.3f\n", i, bit, bit == '1' ? "hammered" : "slept", mysecond());
-        fflush(stdout);
+    double preamble_start = sync_tx_start(BIT_DURATION);
+    double start_time     = preamble_start + SYNC_CHIPS * BIT_DURATION;
 
-        if (bit == '1')
-            hammer_memory(bit_end); 
-        else
-            sleep_until(bit_end);
+    printf("transmitter: preamble starts in %.3fs, bit 0 at %.3f\n",
+           preamble_start - mysecond(), start_time);
+    fflush(stdout);
+    sync_send_preamble(preamble_start, BIT_DURATION, contention_pool_chip, NULL, &pool);
 
+    int rc = 0;
+    if (in) {
+        rc = arq ? send_payload_arq(in, (size_t)chunk, start_time)
+                 : send_payload(in, (size_t)chunk, start_time);
+        if (in != stdin) fclose(in);
+    } else if (pam4) {
+        send_pam4(bits, strlen(bits), start_time);
+    } else {
+        send_binary(bits, strlen(bits), start_time);
     }
 
-    remove(SYNC_FILE);
+    contention_pool_stop(&pool);
+    if (arq) stream_sampler_free(&ack_sampler);
     printf("transmitter: done.\n");
-    return 0;
+    return rc ? 1 : 0;
 }
\ No newline at end of file